@@ -0,0 +1,52 @@
+/*
+ * This program implements a base class for the active queue management
+ * (AQM) of a traffic class.
+ */
+
+#include "aqm.h"
+
+namespace ns3 {
+
+/**
+ * \brief Constructor
+ */
+Aqm::Aqm ()
+  : m_drops (0)
+{
+}
+
+/**
+ * \brief Decide whether to drop an arriving packet
+ * \param tc The traffic class the packet is about to join
+ * \param size Size of the packet in bytes
+ * \return true to drop the packet
+ */
+bool
+Aqm::DropOnEnqueue (const TrafficClass& tc, uint32_t size)
+{
+  return false;
+}
+
+/**
+ * \brief Decide whether to drop a packet that just left the class
+ * \param sojourn Time the packet spent in the class
+ * \param backlog Bytes left in the class
+ * \return true to drop the packet
+ */
+bool
+Aqm::DropOnDequeue (Time sojourn, uint32_t backlog)
+{
+  return false;
+}
+
+/**
+ * \brief Get the number of packets the AQM decided to drop
+ * \return Number of drops
+ */
+uint32_t
+Aqm::GetDropCount () const
+{
+  return m_drops;
+}
+
+} // namespace ns3
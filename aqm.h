@@ -0,0 +1,72 @@
+/*
+ * This program implements a base class for the active queue management
+ * (AQM) of a traffic class.
+ */
+
+#ifndef AQM_H
+#define AQM_H
+
+#include "ns3/nstime.h"
+#include <cstdint>
+
+namespace ns3 {
+
+class TrafficClass;
+
+/**
+ * \brief Base class for the active queue management of a traffic class
+ *
+ * An AQM is attached to a leaf TrafficClass with SetAqm and decides which
+ * packets to drop before the class limits are reached, to keep the
+ * standing queue of the class short. It may drop an arriving packet,
+ * like PIE, or the packet leaving the class, like CoDel. Both decisions
+ * read the enqueue times that the class already keeps in its ring
+ * buffer, so no per-packet state is allocated.
+ */
+class Aqm
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  Aqm ();
+
+  /**
+   * \brief Virtual destructor ensures proper cleanup of derived classes
+   */
+  virtual ~Aqm () = default;
+
+  /**
+   * \brief Decide whether to drop an arriving packet
+   * \param tc The traffic class the packet is about to join
+   * \param size Size of the packet in bytes
+   * \return true to drop the packet
+   *
+   * The default implementation accepts every packet.
+   */
+  virtual bool DropOnEnqueue (const TrafficClass& tc, uint32_t size);
+
+  /**
+   * \brief Decide whether to drop a packet that just left the class
+   * \param sojourn Time the packet spent in the class
+   * \param backlog Bytes left in the class
+   * \return true to drop the packet
+   *
+   * Called once for every packet removed from the class, in order. The
+   * default implementation drops nothing.
+   */
+  virtual bool DropOnDequeue (Time sojourn, uint32_t backlog);
+
+  /**
+   * \brief Get the number of packets the AQM decided to drop
+   * \return Number of drops
+   */
+  uint32_t GetDropCount () const;
+
+protected:
+  uint32_t m_drops;        //!< Number of packets the AQM decided to drop
+};
+
+} // namespace ns3
+
+#endif // AQM_H
@@ -0,0 +1,117 @@
+/*
+ * This program implements a bump allocator that owns the objects it
+ * creates and destroys them all at once.
+ */
+
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates an empty arena; no memory is allocated yet
+ */
+Arena::Arena ()
+  : m_cursor (nullptr),
+    m_end (nullptr),
+    m_nextBlockSize (FIRST_BLOCK_SIZE),
+    m_bytesUsed (0),
+    m_cleanups (nullptr)
+{
+}
+
+/**
+ * \brief Destructor - destroys every object and frees the blocks
+ *
+ * Objects are destroyed newest first, so an object may still use the
+ * objects created before it in its destructor.
+ */
+Arena::~Arena ()
+{
+  for (Cleanup* cleanup = m_cleanups; cleanup != nullptr; cleanup = cleanup->next)
+    {
+      cleanup->destroy (cleanup->object);
+    }
+  for (const Block& block : m_blocks)
+    {
+      delete[] block.data;
+    }
+}
+
+/**
+ * \brief Allocate raw memory owned by the arena
+ * \param size Number of bytes
+ * \param align Alignment, a power of two no larger than alignof (std::max_align_t)
+ * \return The memory, valid until the arena is destroyed
+ */
+void*
+Arena::Allocate (std::size_t size, std::size_t align)
+{
+  uintptr_t cursor = reinterpret_cast<uintptr_t> (m_cursor);
+  uintptr_t aligned = (cursor + align - 1) & ~static_cast<uintptr_t> (align - 1);
+  if (m_cursor == nullptr || aligned + size > reinterpret_cast<uintptr_t> (m_end))
+    {
+      // Start a new block, doubling the block size up to the maximum.
+      // An object larger than that gets a block of its own size.
+      std::size_t blockSize = std::max (m_nextBlockSize, size);
+      m_nextBlockSize = std::min (m_nextBlockSize * 2, MAX_BLOCK_SIZE);
+      m_blocks.push_back ({new char[blockSize], blockSize});
+      m_cursor = m_blocks.back ().data;
+      m_end = m_cursor + blockSize;
+      aligned = reinterpret_cast<uintptr_t> (m_cursor);
+    }
+
+  m_bytesUsed += aligned + size - reinterpret_cast<uintptr_t> (m_cursor);
+  m_cursor = reinterpret_cast<char*> (aligned + size);
+  return reinterpret_cast<void*> (aligned);
+}
+
+/**
+ * \brief Check whether an object lives in the arena
+ * \param object Address of the object
+ * \return true if the object was created by this arena
+ *
+ * Block sizes double, so there are few blocks to check.
+ */
+bool
+Arena::Owns (const void* object) const
+{
+  std::less<const void*> before;
+  for (const Block& block : m_blocks)
+    {
+      if (!before (object, block.data) && before (object, block.data + block.size))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+/**
+ * \brief Get the number of bytes handed out so far
+ * \return Bytes allocated, including alignment padding
+ */
+std::size_t
+Arena::GetBytesUsed () const
+{
+  return m_bytesUsed;
+}
+
+/**
+ * \brief Register the destructor of an object created in the arena
+ * \param object The object
+ * \param destroy Function calling the destructor of the object
+ */
+void
+Arena::AddCleanup (void* object, void (*destroy) (void*))
+{
+  Cleanup* cleanup = new (Allocate (sizeof (Cleanup), alignof (Cleanup))) Cleanup;
+  cleanup->destroy = destroy;
+  cleanup->object = object;
+  cleanup->next = m_cleanups;
+  m_cleanups = cleanup;
+}
+
+} // namespace ns3
@@ -0,0 +1,130 @@
+/*
+ * This program implements a bump allocator that owns the objects it
+ * creates and destroys them all at once.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Region of memory owning the objects created in it
+ *
+ * Objects are placed one after the other in blocks of growing size, so
+ * objects created together, e.g. the filters and filter elements of a
+ * ruleset, are contiguous in memory. Creating an object is a pointer bump
+ * plus, for types with a destructor, one record in a list threaded
+ * through the arena. The objects are never freed one by one: the arena
+ * destructor runs their destructors in reverse order of creation and
+ * frees the blocks in one shot.
+ */
+class Arena
+{
+public:
+  /**
+   * \brief Constructor - creates an empty arena; no memory is allocated yet
+   */
+  Arena ();
+
+  /**
+   * \brief Destructor - destroys every object and frees the blocks
+   */
+  ~Arena ();
+
+  Arena (const Arena&) = delete;
+  Arena& operator= (const Arena&) = delete;
+
+  /**
+   * \brief Create an object owned by the arena
+   * \param args Arguments of the constructor
+   * \return The object, valid until the arena is destroyed; never delete it
+   */
+  template <typename T, typename... Args>
+  T* Create (Args&&... args);
+
+  /**
+   * \brief Allocate raw memory owned by the arena
+   * \param size Number of bytes
+   * \param align Alignment, a power of two no larger than alignof (std::max_align_t)
+   * \return The memory, valid until the arena is destroyed
+   */
+  void* Allocate (std::size_t size, std::size_t align);
+
+  /**
+   * \brief Check whether an object lives in the arena
+   * \param object Address of the object
+   * \return true if the object was created by this arena
+   */
+  bool Owns (const void* object) const;
+
+  /**
+   * \brief Get the number of bytes handed out so far
+   * \return Bytes allocated, including alignment padding
+   */
+  std::size_t GetBytesUsed () const;
+
+private:
+  /**
+   * \brief Destructor record of an object, kept in the arena
+   */
+  struct Cleanup
+  {
+    void (*destroy) (void*);  //!< Destroys the object
+    void* object;             //!< The object
+    Cleanup* next;            //!< Record of the previously created object
+  };
+
+  /**
+   * \brief A block of memory
+   */
+  struct Block
+  {
+    char* data;               //!< First byte
+    std::size_t size;         //!< Number of bytes
+  };
+
+  static constexpr std::size_t FIRST_BLOCK_SIZE = 4096;       //!< Size of the first block
+  static constexpr std::size_t MAX_BLOCK_SIZE = 1 << 20;      //!< Largest block size for small objects
+
+  /**
+   * \brief Register the destructor of an object created in the arena
+   * \param object The object
+   * \param destroy Function calling the destructor of the object
+   */
+  void AddCleanup (void* object, void (*destroy) (void*));
+
+  std::vector<Block> m_blocks;         //!< Blocks, the current one last
+  char* m_cursor;                      //!< Next free byte of the current block
+  char* m_end;                         //!< End of the current block
+  std::size_t m_nextBlockSize;         //!< Size of the next block
+  std::size_t m_bytesUsed;             //!< Bytes handed out
+  Cleanup* m_cleanups;                 //!< Record of the last created object
+};
+
+/**
+ * \brief Create an object owned by the arena
+ * \param args Arguments of the constructor
+ * \return The object, valid until the arena is destroyed; never delete it
+ */
+template <typename T, typename... Args>
+T*
+Arena::Create (Args&&... args)
+{
+  T* object = new (Allocate (sizeof (T), alignof (T))) T (std::forward<Args> (args)...);
+  if (!std::is_trivially_destructible<T>::value)
+    {
+      AddCleanup (object, [] (void* p) { static_cast<T*> (p)->~T (); });
+    }
+  return object;
+}
+
+} // namespace ns3
+
+#endif // ARENA_H
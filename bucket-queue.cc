@@ -0,0 +1,216 @@
+/*
+ * This program implements a bucketed integer priority queue over a
+ * circular window of ranks.
+ */
+
+#include "bucket-queue.h"
+#include <algorithm>
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates an empty queue with no identifiers
+ * \param fractionBits Number of low rank bits sharing a bucket
+ */
+BucketQueue::BucketQueue (uint32_t fractionBits)
+  : m_fractionBits (fractionBits),
+    m_bucketHead (BUCKETS, NONE),
+    m_bucketTail (BUCKETS, NONE),
+    m_windowCount (0),
+    m_base (0),
+    m_last (0)
+{
+}
+
+/**
+ * \brief Grow the range of identifiers, keeping the queue contents
+ * \param n Identifiers range from 0 to n - 1
+ */
+void
+BucketQueue::Resize (uint32_t n)
+{
+  m_next.resize (n, NONE);
+  m_rank.resize (n, 0);
+  m_queued.resize (n, false);
+  m_overflow.Resize (n);
+}
+
+/**
+ * \brief Queue an identifier
+ * \param id Identifier, not already queued
+ * \param rank Rank of the identifier
+ *
+ * An empty window restarts at the bucket of the rank. A lower rank moves
+ * the window back if the highest queued bucket still fits; m_last may
+ * overestimate that bucket after pops, which only sends more ranks to
+ * the overflow heap.
+ */
+void
+BucketQueue::Push (uint32_t id, uint64_t rank)
+{
+  m_rank[id] = rank;
+  m_queued[id] = true;
+
+  uint64_t bucket = rank >> m_fractionBits;
+  if (m_windowCount == 0)
+    {
+      m_base = bucket;
+      m_last = bucket;
+    }
+  else if (bucket < m_base && m_last - bucket < BUCKETS)
+    {
+      m_base = bucket;
+    }
+
+  if (bucket < m_base || bucket - m_base >= BUCKETS)
+    {
+      m_overflow.Push (id, rank);
+      return;
+    }
+
+  m_last = std::max (m_last, bucket);
+  m_windowCount++;
+  Insert (id, bucket % BUCKETS);
+}
+
+/**
+ * \brief Insert an identifier into its bucket, keeping the bucket in rank order
+ * \param id Identifier, with its rank already recorded
+ * \param bucket Bucket index
+ */
+void
+BucketQueue::Insert (uint32_t id, uint32_t bucket)
+{
+  uint32_t tail = m_bucketTail[bucket];
+  if (tail == NONE)
+    {
+      m_next[id] = NONE;
+      m_bucketHead[bucket] = id;
+      m_bucketTail[bucket] = id;
+      m_nonEmpty.Set (bucket);
+      return;
+    }
+  if (m_rank[id] >= m_rank[tail])
+    {
+      m_next[id] = NONE;
+      m_next[tail] = id;
+      m_bucketTail[bucket] = id;
+      return;
+    }
+
+  // Lower than the tail: insert after the last identifier of no higher rank
+  uint32_t prev = NONE;
+  uint32_t cur = m_bucketHead[bucket];
+  while (m_rank[cur] <= m_rank[id])
+    {
+      prev = cur;
+      cur = m_next[cur];
+    }
+  m_next[id] = cur;
+  if (prev == NONE)
+    {
+      m_bucketHead[bucket] = id;
+    }
+  else
+    {
+      m_next[prev] = id;
+    }
+}
+
+/**
+ * \brief Get the bucket of the lowest rank in the window
+ * \return Bucket index, or NONE if the window is empty
+ *
+ * The window wraps around the buckets: the lowest rank is the first
+ * non-empty bucket from the base, or failing that from bucket 0.
+ */
+uint32_t
+BucketQueue::TopBucket () const
+{
+  int bucket = m_nonEmpty.FindNextSet (m_base % BUCKETS);
+  if (bucket < 0)
+    {
+      bucket = m_nonEmpty.FindFirstSet ();
+    }
+  return bucket < 0 ? NONE : static_cast<uint32_t> (bucket);
+}
+
+/**
+ * \brief Get the identifier with the lowest rank
+ * \return The identifier, or NONE if the queue is empty
+ */
+uint32_t
+BucketQueue::Top () const
+{
+  uint32_t bucket = TopBucket ();
+  uint32_t id = bucket == NONE ? NONE : m_bucketHead[bucket];
+  uint32_t overflow = m_overflow.Top ();
+  if (overflow != NONE && (id == NONE || m_rank[overflow] < m_rank[id]))
+    {
+      return overflow;
+    }
+  return id;
+}
+
+/**
+ * \brief Remove the identifier with the lowest rank
+ * \return The identifier; the queue must not be empty
+ *
+ * Taking the lowest rank out of the window moves the window to it.
+ */
+uint32_t
+BucketQueue::Pop ()
+{
+  uint32_t id = Top ();
+  m_queued[id] = false;
+  if (m_overflow.Contains (id))
+    {
+      m_overflow.Remove (id);
+      return id;
+    }
+
+  uint32_t bucket = TopBucket ();
+  m_bucketHead[bucket] = m_next[id];
+  if (m_bucketHead[bucket] == NONE)
+    {
+      m_bucketTail[bucket] = NONE;
+      m_nonEmpty.Clear (bucket);
+    }
+  m_windowCount--;
+  m_base = m_rank[id] >> m_fractionBits;
+  return id;
+}
+
+/**
+ * \brief Get the rank of a queued identifier
+ * \param id Identifier, which must be queued
+ * \return Rank it was pushed with
+ */
+uint64_t
+BucketQueue::GetRank (uint32_t id) const
+{
+  return m_rank[id];
+}
+
+/**
+ * \brief Check whether an identifier is queued
+ * \param id Identifier to check
+ * \return true if the identifier is queued
+ */
+bool
+BucketQueue::Contains (uint32_t id) const
+{
+  return m_queued[id];
+}
+
+/**
+ * \brief Check whether the queue is empty
+ * \return true if the queue is empty
+ */
+bool
+BucketQueue::IsEmpty () const
+{
+  return m_windowCount == 0 && m_overflow.IsEmpty ();
+}
+
+} // namespace ns3
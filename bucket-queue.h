@@ -0,0 +1,122 @@
+/*
+ * This program implements a bucketed integer priority queue over a
+ * circular window of ranks.
+ */
+
+#ifndef BUCKET_QUEUE_H
+#define BUCKET_QUEUE_H
+
+#include "indexed-heap.h"
+#include "priority-bitmap.h"
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Push-in-first-out queue of identifiers ordered by integer rank
+ *
+ * Identifiers 0..n-1 are queued with a 64-bit rank and extracted in rank
+ * order. As in Eiffel, a window of PriorityBitmap::MAX_LEVELS
+ * consecutive buckets holds the ranks, each bucket covering
+ * 2^fractionBits ranks, and a bitmap marks the non-empty buckets. A
+ * bucket is a list threaded through the identifiers and kept in rank
+ * order; ranks are usually pushed in increasing order, so an insert
+ * appends at the tail. Push and Pop are then O(1): a bucket append, and
+ * a find-first-set lookup followed by a bucket removal.
+ *
+ * The buckets are used circularly as the window moves. The window starts
+ * at the first rank pushed into an empty queue, follows the extracted
+ * ranks, and moves back for a lower rank as long as every queued rank
+ * still fits. A rank that does not fit goes to an overflow heap, which
+ * is O(log n) but keeps the order exact for ranks of any spread. Equal
+ * ranks leave first in first out within the window, and by identifier
+ * in the overflow heap.
+ */
+class BucketQueue
+{
+public:
+  static constexpr uint32_t NONE = 0xffffffff;                        //!< No identifier
+  static constexpr uint32_t BUCKETS = PriorityBitmap::MAX_LEVELS;     //!< Width of the window in buckets
+
+  /**
+   * \brief Constructor - creates an empty queue with no identifiers
+   * \param fractionBits Number of low rank bits sharing a bucket
+   */
+  explicit BucketQueue (uint32_t fractionBits = 0);
+
+  /**
+   * \brief Grow the range of identifiers, keeping the queue contents
+   * \param n Identifiers range from 0 to n - 1
+   */
+  void Resize (uint32_t n);
+
+  /**
+   * \brief Queue an identifier
+   * \param id Identifier, not already queued
+   * \param rank Rank of the identifier
+   */
+  void Push (uint32_t id, uint64_t rank);
+
+  /**
+   * \brief Get the identifier with the lowest rank
+   * \return The identifier, or NONE if the queue is empty
+   */
+  uint32_t Top () const;
+
+  /**
+   * \brief Remove the identifier with the lowest rank
+   * \return The identifier; the queue must not be empty
+   */
+  uint32_t Pop ();
+
+  /**
+   * \brief Get the rank of a queued identifier
+   * \param id Identifier, which must be queued
+   * \return Rank it was pushed with
+   */
+  uint64_t GetRank (uint32_t id) const;
+
+  /**
+   * \brief Check whether an identifier is queued
+   * \param id Identifier to check
+   * \return true if the identifier is queued
+   */
+  bool Contains (uint32_t id) const;
+
+  /**
+   * \brief Check whether the queue is empty
+   * \return true if the queue is empty
+   */
+  bool IsEmpty () const;
+
+private:
+  /**
+   * \brief Get the bucket of the lowest rank in the window
+   * \return Bucket index, or NONE if the window is empty
+   */
+  uint32_t TopBucket () const;
+
+  /**
+   * \brief Insert an identifier into its bucket, keeping the bucket in rank order
+   * \param id Identifier, with its rank already recorded
+   * \param bucket Bucket index
+   */
+  void Insert (uint32_t id, uint32_t bucket);
+
+  uint32_t m_fractionBits;              //!< Low rank bits sharing a bucket
+  PriorityBitmap m_nonEmpty;            //!< Buckets holding identifiers
+  std::vector<uint32_t> m_bucketHead;   //!< First identifier of each bucket
+  std::vector<uint32_t> m_bucketTail;   //!< Last identifier of each bucket
+  std::vector<uint32_t> m_next;         //!< Next identifier in the same bucket
+  std::vector<uint64_t> m_rank;         //!< Rank of each identifier
+  std::vector<bool> m_queued;           //!< Whether each identifier is queued
+  IndexedHeap m_overflow;               //!< Identifiers whose rank did not fit the window
+  uint32_t m_windowCount;               //!< Number of identifiers in the window
+  uint64_t m_base;                      //!< First bucket number of the window
+  uint64_t m_last;                      //!< Bucket number no queued rank of the window exceeds
+};
+
+} // namespace ns3
+
+#endif // BUCKET_QUEUE_H
@@ -0,0 +1,111 @@
+/*
+ * This program implements the Controlled Delay (CoDel) active queue
+ * management algorithm for a traffic class.
+ */
+
+#include "codel.h"
+#include "ns3/simulator.h"
+#include <cmath>
+
+namespace ns3 {
+
+/**
+ * \brief Constructor
+ * \param target Acceptable standing queue delay
+ * \param interval Time a delay above the target is tolerated
+ */
+CoDel::CoDel (Time target, Time interval)
+  : m_target (target),
+    m_interval (interval),
+    m_firstAboveTime (Seconds (0)),
+    m_dropNext (Seconds (0)),
+    m_count (0),
+    m_lastCount (0),
+    m_dropping (false)
+{
+}
+
+/**
+ * \brief Check whether the sojourn time has been above the target for an interval
+ * \param sojourn Time the packet spent in the class
+ * \param backlog Bytes left in the class
+ * \param now The current time
+ * \return true if the packet may be dropped
+ */
+bool
+CoDel::OkToDrop (Time sojourn, uint32_t backlog, Time now)
+{
+  // A short queue, or a single packet, is not a standing queue
+  if (sojourn < m_target || backlog <= MTU)
+    {
+      m_firstAboveTime = Seconds (0);
+      return false;
+    }
+
+  if (m_firstAboveTime.IsZero ())
+    {
+      m_firstAboveTime = now + m_interval;
+      return false;
+    }
+  return now >= m_firstAboveTime;
+}
+
+/**
+ * \brief Get the time of the next drop
+ * \param t Time of the previous drop
+ * \return t plus the interval over the square root of the drop count
+ */
+Time
+CoDel::ControlLaw (Time t) const
+{
+  return t + Seconds (m_interval.GetSeconds () / std::sqrt (m_count));
+}
+
+/**
+ * \brief Run the CoDel state machine for a packet that just left the class
+ * \param sojourn Time the packet spent in the class
+ * \param backlog Bytes left in the class
+ * \return true to drop the packet
+ *
+ * This is the dequeue loop of RFC 8289 taken one packet at a time: the
+ * caller dequeues the next packet after every drop.
+ */
+bool
+CoDel::DropOnDequeue (Time sojourn, uint32_t backlog)
+{
+  Time now = Simulator::Now ();
+  bool okToDrop = OkToDrop (sojourn, backlog, now);
+
+  if (m_dropping)
+    {
+      // Leave the dropping state as soon as the delay is back below target
+      if (!okToDrop)
+        {
+          m_dropping = false;
+          return false;
+        }
+      if (now >= m_dropNext)
+        {
+          m_count++;
+          m_dropNext = ControlLaw (m_dropNext);
+          m_drops++;
+          return true;
+        }
+      return false;
+    }
+
+  if (okToDrop)
+    {
+      // Resume near the previous drop rate if the last dropping state was recent
+      m_dropping = true;
+      uint32_t delta = m_count - m_lastCount;
+      m_count = (delta > 1 && now - m_dropNext < m_interval * 16) ? delta : 1;
+      m_dropNext = ControlLaw (now);
+      m_lastCount = m_count;
+      m_drops++;
+      return true;
+    }
+  return false;
+}
+
+} // namespace ns3
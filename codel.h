@@ -0,0 +1,72 @@
+/*
+ * This program implements the Controlled Delay (CoDel) active queue
+ * management algorithm for a traffic class.
+ */
+
+#ifndef CODEL_H
+#define CODEL_H
+
+#include "aqm.h"
+
+namespace ns3 {
+
+/**
+ * \brief Controlled Delay (CoDel) AQM, RFC 8289
+ *
+ * CoDel looks at the sojourn time of every packet leaving the class. Once
+ * it has stayed above the target for a whole interval, the class enters
+ * the dropping state: the leaving packet is dropped, and further drops
+ * follow at intervals shrinking with the square root of the number of
+ * drops, until a packet leaves with a sojourn time below the target. The
+ * standing queue is thereby kept near the target whatever the class
+ * limits.
+ */
+class CoDel : public Aqm
+{
+public:
+  /**
+   * \brief Constructor
+   * \param target Acceptable standing queue delay (default 5 ms)
+   * \param interval Time a delay above the target is tolerated (default 100 ms)
+   */
+  CoDel (Time target = MilliSeconds (5), Time interval = MilliSeconds (100));
+
+  /**
+   * \brief Run the CoDel state machine for a packet that just left the class
+   * \param sojourn Time the packet spent in the class
+   * \param backlog Bytes left in the class
+   * \return true to drop the packet
+   */
+  bool DropOnDequeue (Time sojourn, uint32_t backlog) override;
+
+private:
+  static constexpr uint32_t MTU = 1500;   //!< Backlog below which nothing is dropped
+
+  /**
+   * \brief Check whether the sojourn time has been above the target for an interval
+   * \param sojourn Time the packet spent in the class
+   * \param backlog Bytes left in the class
+   * \param now The current time
+   * \return true if the packet may be dropped
+   */
+  bool OkToDrop (Time sojourn, uint32_t backlog, Time now);
+
+  /**
+   * \brief Get the time of the next drop
+   * \param t Time of the previous drop
+   * \return t plus the interval over the square root of the drop count
+   */
+  Time ControlLaw (Time t) const;
+
+  Time m_target;            //!< Acceptable standing queue delay
+  Time m_interval;          //!< Time a delay above the target is tolerated
+  Time m_firstAboveTime;    //!< When the delay will have been above target for an interval (0 = below)
+  Time m_dropNext;          //!< Time of the next drop in the dropping state
+  uint32_t m_count;         //!< Drops since entering the dropping state
+  uint32_t m_lastCount;     //!< Value of m_count when the dropping state was last entered
+  bool m_dropping;          //!< Whether CoDel is in the dropping state
+};
+
+} // namespace ns3
+
+#endif // CODEL_H
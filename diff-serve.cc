@@ -6,10 +6,12 @@
 #include "diff-serve.h"
 #include "traffic-class.h"
 #include "filter.h"
+#include "flow-key.h"
+#include "ns3/simulator.h"
+#include <algorithm>
 #include <iostream>
-#include "ns3/ipv4-header.h"
-#include "ns3/tcp-header.h"
-#include "ns3/udp-header.h"
+#include <iterator>
+#include <unordered_set>
 
 namespace ns3 {
 
@@ -17,22 +19,84 @@ namespace ns3 {
  * \brief Constructor
  */
 DiffServ::DiffServ () 
+  : m_rulesetVersion (0),
+    m_classifierVersion (0),
+    m_linkType (LINK_AUTO),
+    m_l3Offset (0),
+    m_scheduled {-1, nullptr},
+    m_scheduleValid (false),
+    m_pendingClass (-1),
+    m_shaperTick (MicroSeconds (100)),
+    m_parent (nullptr),
+    m_parentIndex (0),
+    m_deviceIdle (false),
+    m_handedBack (false)
 {
 }
 
 /**
- * \brief Destructor - cleans up all traffic classes
+ * \brief Destructor - cleans up all traffic classes, filters and filter elements
+ *
+ * Only the objects allocated with new are deleted here; the arena then
+ * releases the others.
  */
 DiffServ::~DiffServ () 
 {
-  // Delete all traffic classes
+  m_shaperEvent.Cancel ();
+  m_restartEvent.Cancel ();
+
+  // A filter or element may be shared between classes or filters, so the
+  // heap-allocated ones are collected first and deleted once each
+  std::unordered_set<Filter*> filters;
+  std::unordered_set<FilterElement*> elements;
   for (auto tc : m_queueClasses) 
     {
-      delete tc;
+      for (Filter* filter : tc->GetFilters ())
+        {
+          if (!m_arena.Owns (filter))
+            {
+              filters.insert (filter);
+            }
+          for (FilterElement* element : filter->GetFilters ())
+            {
+              if (!m_arena.Owns (element))
+                {
+                  elements.insert (element);
+                }
+            }
+        }
+    }
+  for (auto element : elements)
+    {
+      delete element;
+    }
+  for (auto filter : filters)
+    {
+      delete filter;
+    }
+
+  // Delete the heap-allocated traffic classes
+  for (auto tc : m_queueClasses) 
+    {
+      if (!m_arena.Owns (tc))
+        {
+          delete tc;
+        }
     }
   m_queueClasses.clear ();
 }
 
+/**
+ * \brief Get the arena owning the classification objects of this queue
+ * \return The arena, from which classes, filters and filter elements
+ *         may be created instead of with new
+ */
+Arena&
+DiffServ::GetArena ()
+{
+  return m_arena;
+}
+
 /**
  * \brief Add a traffic class to the DiffServ queue
  * \param trafficClass Pointer to the traffic class to add
@@ -41,6 +105,266 @@ void
 DiffServ::AddClass (TrafficClass* trafficClass) 
 {
   m_queueClasses.push_back (trafficClass);
+  m_classState.push_back (CLASS_IDLE);
+  m_shaperWheel.Resize (m_queueClasses.size ());
+  trafficClass->SetOwner (this);
+  InvalidateSchedule ();
+
+  // A child scheduler reports the classes its shaper releases to this one
+  if (trafficClass->GetChild () != nullptr)
+    {
+      trafficClass->GetChild ()->m_parent = this;
+      trafficClass->GetChild ()->m_parentIndex = m_queueClasses.size () - 1;
+    }
+
+  // The aggregate limit of the base class is the sum of the class limits,
+  // so that only the per-class limits ever reject a packet. One more packet
+  // lets a full flow-queued class take a packet in before evicting one.
+  uint64_t maxPackets = 1;
+  for (auto tc : m_queueClasses)
+    {
+      maxPackets += tc->GetMaxPackets ();
+    }
+  SetMaxSize (QueueSize (PACKETS, static_cast<uint32_t> (std::min<uint64_t> (maxPackets, UINT32_MAX))));
+}
+
+/**
+ * \brief Set the period of the shaper timing wheel
+ * \param tick Granularity at which shaped classes are released
+ */
+void
+DiffServ::SetShaperTick (Time tick)
+{
+  m_shaperTick = tick;
+}
+
+/**
+ * \brief Get the period of the shaper timing wheel
+ * \return Granularity at which shaped classes are released
+ */
+Time
+DiffServ::GetShaperTick () const
+{
+  return m_shaperTick;
+}
+
+/**
+ * \brief Set the link-layer framing of the packets given to the queue
+ * \param linkType The framing used by the device the queue is attached to
+ */
+void
+DiffServ::SetLinkType (LinkType linkType)
+{
+  m_linkType = linkType;
+  m_l3Offset = FlowKey::GetL3Offset (linkType);
+}
+
+/**
+ * \brief Get the link-layer framing of the packets given to the queue
+ * \return The link type, or LINK_AUTO if not known yet
+ */
+LinkType
+DiffServ::GetLinkType () const
+{
+  return m_linkType;
+}
+
+/**
+ * \brief Notify the scheduler that a packet was added to a traffic class
+ * \param index Index of the traffic class the packet was enqueued into
+ */
+void
+DiffServ::NotifyEnqueue (uint32_t index)
+{
+}
+
+/**
+ * \brief Notify the scheduler that a packet left a traffic class
+ * \param index Index of the traffic class the packet was dequeued from
+ * \param size Size of the dequeued packet in bytes
+ */
+void
+DiffServ::NotifyDequeue (uint32_t index, uint32_t size)
+{
+}
+
+/**
+ * \brief Get how long a selected class may be served without a new decision
+ * \param index Index of the traffic class Schedule just selected
+ * \return Bytes the class may send, its first packet included
+ *
+ * The first packet is sent whatever the budget, so with 0 every packet
+ * is scheduled on its own.
+ */
+uint32_t
+DiffServ::GetBurstBudget (uint32_t index) const
+{
+  return 0;
+}
+
+/**
+ * \brief Check whether a class takes part in scheduling
+ * \param index Index of the traffic class
+ * \return true if the class has a packet that may be sent now
+ */
+bool
+DiffServ::IsReady (uint32_t index) const
+{
+  return m_classState[index] == CLASS_ACTIVE;
+}
+
+/**
+ * \brief Check whether a class has a packet its scheduler could reach
+ * \param index Index of the traffic class
+ * \return true if the class, or the child scheduler of a node, has one
+ */
+bool
+DiffServ::HasBacklog (uint32_t index) const
+{
+  const TrafficClass* tc = m_queueClasses[index];
+  return !tc->IsEmpty ()
+         && (tc->GetChild () == nullptr || tc->GetChild ()->GetSchedule ().index >= 0);
+}
+
+/**
+ * \brief Hand an idle class to the scheduler, or park it if it has no tokens
+ * \param index Index of the traffic class
+ * \return true if the class became active
+ */
+bool
+DiffServ::ActivateClass (uint32_t index)
+{
+  if (m_classState[index] != CLASS_IDLE || !HasBacklog (index))
+    {
+      return false;
+    }
+
+  TrafficClass* tc = m_queueClasses[index];
+  if (tc->IsShaped ())
+    {
+      tc->UpdateTokens (Simulator::Now ());
+      if (!tc->HasTokens ())
+        {
+          ParkClass (index);
+          return false;
+        }
+    }
+
+  m_classState[index] = CLASS_ACTIVE;
+  NotifyEnqueue (index);
+  InvalidateSchedule ();
+  return true;
+}
+
+/**
+ * \brief Hold a class back until its bucket has the tokens for its head packet
+ * \param index Index of the traffic class, with updated tokens
+ */
+void
+DiffServ::ParkClass (uint32_t index)
+{
+  // The wheel does not move while it is empty
+  Time now = Simulator::Now ();
+  int64_t tick = m_shaperTick.GetTimeStep ();
+  if (m_shaperWheel.IsEmpty ())
+    {
+      m_shaperWheel.Reset (now.GetTimeStep () / tick);
+    }
+
+  // Round up, so that the class has its tokens when the tick comes
+  Time wake = now + m_queueClasses[index]->GetTokenDelay ();
+  m_shaperWheel.Schedule (index, (wake.GetTimeStep () + tick - 1) / tick);
+  m_classState[index] = CLASS_PARKED;
+
+  if (m_shaperEvent.IsExpired ())
+    {
+      Time next = m_shaperTick * (m_shaperWheel.GetCurrentTick () + 1);
+      m_shaperEvent = Simulator::Schedule (next - now, &DiffServ::ShaperTick, this);
+    }
+}
+
+/**
+ * \brief Release the parked classes whose tick has come
+ *
+ * A single event per tick serves every parked class, and no event is
+ * scheduled while no class is parked. A released class whose head grew
+ * meanwhile is parked again, which already schedules the next tick when
+ * it finds no event pending.
+ */
+void
+DiffServ::ShaperTick ()
+{
+  m_expired.clear ();
+  m_shaperWheel.Advance (m_expired);
+  for (uint32_t index : m_expired)
+    {
+      m_classState[index] = CLASS_IDLE;
+      WakeClass (index);
+    }
+
+  if (!m_shaperWheel.IsEmpty () && m_shaperEvent.IsExpired ())
+    {
+      m_shaperEvent = Simulator::Schedule (m_shaperTick, &DiffServ::ShaperTick, this);
+    }
+}
+
+/**
+ * \brief Activate a class and the scheduler nodes above it
+ * \param index Index of the traffic class
+ *
+ * The released class may change the packet every level above would
+ * serve, so their cached decisions are discarded too. The root restarts
+ * the device if it went idle, from an event of its own so that the
+ * release completes first.
+ */
+void
+DiffServ::WakeClass (uint32_t index)
+{
+  ActivateClass (index);
+  InvalidateSchedule ();
+  if (m_parent != nullptr)
+    {
+      m_parent->WakeClass (m_parentIndex);
+    }
+  else if (m_deviceIdle && !m_transmit.IsNull () && m_restartEvent.IsExpired ())
+    {
+      m_restartEvent = Simulator::ScheduleNow (&DiffServ::RestartDevice, this);
+    }
+}
+
+/**
+ * \brief Set how a packet released by the shaper reaches an idle device
+ * \param transmit Callback handing a packet to the device the queue is
+ *        attached to, returning whether the device accepted it
+ */
+void
+DiffServ::SetTransmitCallback (Callback<bool, Ptr<Packet>> transmit)
+{
+  m_transmit = transmit;
+}
+
+/**
+ * \brief Hand the packet the scheduler selects to the idle device
+ *
+ * The device may have found a packet since the restart was scheduled,
+ * in which case it is no longer idle and nothing is done. A device that
+ * refuses the packet, e.g. because its link is down, drops it itself.
+ */
+void
+DiffServ::RestartDevice ()
+{
+  if (!m_deviceIdle)
+    {
+      return;
+    }
+  Ptr<Packet> packet = DoDequeue ();
+  if (packet == nullptr)
+    {
+      return;
+    }
+  m_handoff = packet;
+  m_transmit (packet);
+  m_handoff = nullptr;
 }
 
 /**
@@ -84,16 +408,144 @@ DiffServ::Remove ()
   return DoRemove ();
 }
 
+/**
+ * \brief Enqueue a burst of packets into their traffic classes
+ * \param packets First packet of the burst
+ * \param count Number of packets in the burst
+ * \return Number of packets enqueued; the others were dropped
+ */
+uint32_t
+DiffServ::EnqueueBatch (const Ptr<Packet>* packets, uint32_t count)
+{
+  uint32_t enqueued = 0;
+  FlowKey lastKey;
+  bool lastValid = false;
+  for (uint32_t i = 0; i < count; i++)
+    {
+      FlowKey key = ParseKey (packets[i]);
+
+      // A run of packets of one flow is classified once, unless a custom
+      // filter element may tell them apart
+      if (!lastValid || !key.IsSameFlow (lastKey))
+        {
+          m_pendingClass = Classify (key);
+          lastKey = key;
+          lastValid = !m_classifier.HasOpaqueRules ();
+        }
+
+      if (EnqueueClassified (packets[i], key))
+        {
+          enqueued++;
+        }
+    }
+  return enqueued;
+}
+
+/**
+ * \brief Dequeue packets until a packet or byte limit is reached
+ * \param maxPackets Largest number of packets to dequeue
+ * \param maxBytes Largest number of bytes to dequeue, or 0 for no byte limit
+ * \param packets Vector the dequeued packets are appended to
+ * \return Number of packets dequeued
+ */
+uint32_t
+DiffServ::DequeueBatch (uint32_t maxPackets, uint32_t maxBytes, std::vector<Ptr<Packet>>& packets)
+{
+  uint32_t dequeued = 0;
+  uint32_t bytes = 0;
+  while (dequeued < maxPackets)
+    {
+      int index = GetSchedule ().index;
+      if (index < 0)
+        {
+          break;
+        }
+
+      // Serve the selected class while the scheduler would select it again
+      TrafficClass* tc = m_queueClasses[index];
+      uint32_t budget = GetBurstBudget (index);
+      do
+        {
+          if (maxBytes != 0 && bytes + tc->GetHeadSize () > maxBytes)
+            {
+              return dequeued;
+            }
+
+          QueueSlot slot = TakeFrom (index);
+          Ptr<Packet> packet = Queue<Packet>::DoDequeue (slot.handle);
+          if (slot.drop)
+            {
+              DropAfterDequeue (packet);
+              continue;
+            }
+
+          packets.push_back (packet);
+          dequeued++;
+          bytes += slot.size;
+          budget -= std::min (budget, slot.size);
+        }
+      while (dequeued < maxPackets && IsReady (index) && tc->GetHeadSize () <= budget);
+    }
+  return dequeued;
+}
+
 /**
  * \brief Get all traffic classes
  * \return Vector of traffic classes
  */
-std::vector<TrafficClass*> 
+const std::vector<TrafficClass*>& 
 DiffServ::GetClasses () const
 {
   return m_queueClasses;
 }
 
+/**
+ * \brief Record that a class or filter of this scheduler changed
+ */
+void
+DiffServ::NotifyRulesetChanged ()
+{
+  m_rulesetVersion++;
+}
+
+/**
+ * \brief Print the sojourn-time percentiles of every traffic class
+ * \param os Output stream
+ */
+void
+DiffServ::PrintSojournTimes (std::ostream& os) const
+{
+  os << "class packets p50(us) p99(us) p99.9(us) max(us)" << std::endl;
+  PrintSojournRows (os, "");
+}
+
+/**
+ * \brief Print one sojourn-time line per class, then the lines of its children
+ * \param os Output stream
+ * \param prefix Label of the parent class followed by a dot, or empty at the root
+ */
+void
+DiffServ::PrintSojournRows (std::ostream& os, const std::string& prefix) const
+{
+  for (uint32_t i = 0; i < m_queueClasses.size (); i++)
+    {
+      const SojournHistogram& histogram = m_queueClasses[i]->GetSojournHistogram ();
+      std::string label = prefix + std::to_string (i);
+      os << label
+         << " " << histogram.GetCount ()
+         << " " << histogram.GetPercentile (50).GetMicroSeconds ()
+         << " " << histogram.GetPercentile (99).GetMicroSeconds ()
+         << " " << histogram.GetPercentile (99.9).GetMicroSeconds ()
+         << " " << histogram.GetMax ().GetMicroSeconds ()
+         << std::endl;
+
+      if (m_queueClasses[i]->GetChild () != nullptr)
+        {
+          m_queueClasses[i]->GetChild ()->PrintSojournRows (os, label + ".");
+        }
+    }
+}
+
 /**
  * \brief Internal implementation of Enqueue
  * \param packet Packet to enqueue
@@ -102,18 +554,188 @@ DiffServ::GetClasses () const
 bool 
 DiffServ::DoEnqueue (Ptr<Packet> packet) 
 {
-  // Classify the packet to determine which traffic class it belongs to
-  int classIndex = Classify (packet);
-  
-  // If a valid traffic class was found, enqueue the packet
-  if (classIndex > -1 && classIndex < int(m_queueClasses.size ())) 
+  // The packet RestartDevice handed to the device is already scheduled:
+  // keep it aside for the Dequeue the device makes right away
+  if (packet == m_handoff)
     {
-      bool result = m_queueClasses[classIndex]->Enqueue (packet);
-      return result;
+      if (!Queue<Packet>::DoEnqueue (GetContainer ().end (), packet))
+        {
+          return false;
+        }
+      m_handoffHandle = std::prev (GetContainer ().end ());
+      m_handedBack = true;
+      return true;
     }
-  
-  // No valid traffic class found
-  return false;
+
+  // Parse the headers once and classify the packet to determine
+  // which traffic class it belongs to
+  FlowKey key = ParseKey (packet);
+  m_pendingClass = Classify (key);
+  return EnqueueClassified (packet, key);
+}
+
+/**
+ * \brief Get the classification fields of a packet given to the root
+ * \param packet The packet
+ * \return The parsed header fields, only the length if the framing is unknown
+ */
+FlowKey
+DiffServ::ParseKey (Ptr<const Packet> packet)
+{
+  // Learn the framing of the device from the first packet only one fits
+  if (m_linkType == LINK_AUTO)
+    {
+      SetLinkType (FlowKey::DetectLinkType (packet));
+    }
+
+  if (m_linkType != LINK_AUTO)
+    {
+      return FlowKey::Parse (packet, m_l3Offset);
+    }
+  FlowKey key;
+  key.length = packet->GetSize ();
+  return key;
+}
+
+/**
+ * \brief Enqueue a packet into the class found by the last Classify
+ * \param packet Packet to enqueue
+ * \param key The parsed header fields of the packet
+ * \return true if the packet was successfully enqueued
+ */
+bool
+DiffServ::EnqueueClassified (Ptr<Packet> packet, const FlowKey& key)
+{
+  // Drop the packet if no valid traffic class was found or a class on its
+  // path is full
+  if (!CanStorePending (key, packet->GetSize ()))
+    {
+      DropBeforeEnqueue (packet);
+      return false;
+    }
+
+  // Let the base class account for the packet and fire the Enqueue trace.
+  // It drops and traces the packet itself if the aggregate limit is hit.
+  if (!Queue<Packet>::DoEnqueue (GetContainer ().end (), packet))
+    {
+      return false;
+    }
+
+  // Store the packet in its traffic class together with its position in
+  // the base-class container, so that it can be dequeued from both in O(1)
+  QueueSlot evicted = Store (key, packet, std::prev (GetContainer ().end ()));
+
+  // A full flow-queued class made room by evicting the head packet of its
+  // largest flow: remove it from the base class and fire the Drop trace
+  if (evicted.packet != nullptr)
+    {
+      Queue<Packet>::DoRemove (evicted.handle);
+    }
+  return true;
+}
+
+/**
+ * \brief Classify a packet and check that every class on its path accepts it
+ * \param key The parsed header fields of the packet
+ * \param size Packet size in bytes
+ * \return true if the packet can be stored
+ */
+bool
+DiffServ::CanStore (const FlowKey& key, uint32_t size)
+{
+  m_pendingClass = Classify (key);
+  return CanStorePending (key, size);
+}
+
+/**
+ * \brief Check that every class on the path of a packet accepts it
+ * \param key The parsed header fields of the packet
+ * \param size Packet size in bytes
+ * \return true if the class found by the last Classify, and its children, accept it
+ */
+bool
+DiffServ::CanStorePending (const FlowKey& key, uint32_t size)
+{
+  return m_pendingClass >= 0 && m_pendingClass < int (m_queueClasses.size ())
+         && m_queueClasses[m_pendingClass]->CanStore (key, size);
+}
+
+/**
+ * \brief Check whether the class found by the last CanStore makes room by evicting a packet
+ * \param size Set to the size of the packet to evict
+ * \return true if Store will evict a packet
+ */
+bool
+DiffServ::GetPendingEviction (uint32_t& size) const
+{
+  return m_pendingClass >= 0 && m_queueClasses[m_pendingClass]->GetPendingEviction (size);
+}
+
+/**
+ * \brief Store a packet in the class found by the last CanStore
+ * \param key The parsed header fields of the packet
+ * \param packet Packet to store
+ * \param handle Position of the packet in the root base-class container
+ * \return The descriptor of a packet evicted to make room, whose packet
+ *         is nullptr if none was
+ */
+QueueSlot
+DiffServ::Store (const FlowKey& key, Ptr<Packet> packet, std::list<Ptr<Packet>>::const_iterator handle)
+{
+  QueueSlot evicted = m_queueClasses[m_pendingClass]->Store (key, packet, handle);
+  ActivateClass (m_pendingClass);
+  InvalidateSchedule ();
+  return evicted;
+}
+
+/**
+ * \brief Remove the packet selected by the scheduler
+ * \return The descriptor of the packet; a packet must be available
+ */
+QueueSlot
+DiffServ::TakeScheduled ()
+{
+  return TakeFrom (GetSchedule ().index);
+}
+
+/**
+ * \brief Remove the next packet of a class
+ * \param index Index of a class the scheduler selected
+ * \return The descriptor of the packet
+ */
+QueueSlot
+DiffServ::TakeFrom (uint32_t index)
+{
+  TrafficClass* tc = m_queueClasses[index];
+  QueueSlot slot = tc->TakeSlot ();
+
+  // The class stays with the scheduler while its next packet may be sent
+  // now; otherwise it is idle or parked until its bucket refills
+  if (tc->IsShaped ())
+    {
+      tc->UpdateTokens (Simulator::Now ());
+      if (!slot.drop)
+        {
+          tc->ConsumeTokens (slot.size);
+        }
+    }
+  m_classState[index] = CLASS_IDLE;
+  if (HasBacklog (index))
+    {
+      if (!tc->IsShaped () || tc->HasTokens ())
+        {
+          m_classState[index] = CLASS_ACTIVE;
+        }
+      else
+        {
+          ParkClass (index);
+        }
+    }
+
+  // A packet dropped by the AQM of its class is no service
+  NotifyDequeue (index, slot.drop ? 0 : slot.size);
+  InvalidateSchedule ();
+  return slot;
 }
 
 /**
@@ -123,25 +745,40 @@ DiffServ::DoEnqueue (Ptr<Packet> packet)
 Ptr<Packet> 
 DiffServ::DoDequeue () 
 {
-  // Schedule() returns the next packet to dequeue based on the scheduling algorithm
-  Ptr<const Packet> packet = Schedule ();
-  if (packet == nullptr) 
+  // The packet RestartDevice handed to the device leaves first
+  if (m_handedBack)
     {
-      return nullptr;
+      m_handedBack = false;
+      m_deviceIdle = false;
+      return Queue<Packet>::DoDequeue (m_handoffHandle);
     }
-  
-  // Find which traffic class this packet belongs to
-  for (size_t i = 0; i < m_queueClasses.size (); i++) 
+
+  while (true)
     {
-      if (!m_queueClasses[i]->IsEmpty () && m_queueClasses[i]->Peek () == packet) 
+      // Schedule() selects the traffic class to serve based on the scheduling
+      // algorithm, unless a Peek already did. With nothing to send, the
+      // device stays idle until it enqueues a packet or is restarted.
+      if (GetSchedule ().index < 0) 
         {
-          // Found the traffic class, dequeue from it
-          return m_queueClasses[i]->Dequeue ();
+          m_deviceIdle = true;
+          return nullptr;
         }
-    }
   
-  // If we couldn't find the traffic class (shouldn't happen), return nullptr
-  return nullptr;
+      // Dequeue directly from the selected traffic class, and through the
+      // child schedulers down to a leaf class for scheduler nodes
+      QueueSlot slot = TakeScheduled ();
+
+      // Update the base-class statistics and fire the Dequeue trace
+      Ptr<Packet> packet = Queue<Packet>::DoDequeue (slot.handle);
+      if (!slot.drop)
+        {
+          m_deviceIdle = false;
+          return packet;
+        }
+
+      // The AQM of the class dropped the packet: count it and serve the next one
+      DropAfterDequeue (packet);
+    }
 }
 
 /**
@@ -151,24 +788,21 @@ DiffServ::DoDequeue ()
 Ptr<Packet> 
 DiffServ::DoRemove () 
 {
-  Ptr<const Packet> packet = Schedule ();
-  if (packet == nullptr) 
+  if (m_handedBack)
     {
-      return nullptr;
+      m_handedBack = false;
+      return Queue<Packet>::DoRemove (m_handoffHandle);
     }
-  
-  // Find which traffic class this packet belongs to
-  for (size_t i = 0; i < m_queueClasses.size (); i++) 
+  if (GetSchedule ().index < 0) 
     {
-      if (!m_queueClasses[i]->IsEmpty () && m_queueClasses[i]->Peek () == packet) 
-        {
-          // Found the traffic class, dequeue from it
-          return m_queueClasses[i]->Dequeue ();
-        }
+      return nullptr;
     }
   
-  // If we couldn't find the traffic class (shouldn't happen), return nullptr
-  return nullptr;
+  // Remove the head packet of the selected traffic class
+  QueueSlot slot = TakeScheduled ();
+
+  // Update the base-class statistics and fire the Dequeue and Drop traces
+  return Queue<Packet>::DoRemove (slot.handle);
 }
 
 /**
@@ -178,38 +812,87 @@ DiffServ::DoRemove ()
 Ptr<const Packet> 
 DiffServ::DoPeek () const 
 {
-  Ptr<const Packet> pkt = Schedule ();
-  return pkt != nullptr ? pkt->Copy () : nullptr;
+  // Hand out the stored packet itself; the caller only gets a const view
+  if (m_handedBack)
+    {
+      return *m_handoffHandle;
+    }
+  return GetSchedule ().packet;
+}
+
+/**
+ * \brief Get the scheduling decision, running Schedule only if needed
+ * \return The selected traffic class and its head packet
+ */
+ScheduleResult
+DiffServ::GetSchedule () const
+{
+  if (!m_scheduleValid)
+    {
+      m_scheduled = Schedule ();
+      m_scheduleValid = true;
+    }
+  return m_scheduled;
+}
+
+/**
+ * \brief Discard the cached scheduling decision
+ */
+void
+DiffServ::InvalidateSchedule ()
+{
+  m_scheduleValid = false;
+  m_scheduled.packet = nullptr;
 }
 
 /**
  * \brief Classify a packet into a traffic class
- * \param packet Packet to classify
+ * \param key The parsed header fields of the packet to classify
  * \return Index of the traffic class that matches the packet, or -1 if no match
  */
 int 
-DiffServ::Classify (Ptr<Packet> packet) 
+DiffServ::Classify (const FlowKey& key) 
 {
-  int defaultIndex = -1;
+  // Recompile the classifier after any change to the classes or their filters
+  if (m_classifierVersion != m_rulesetVersion)
+    {
+      m_classifier.Build (m_queueClasses);
+      m_classifierVersion = m_rulesetVersion;
+      m_flowCache.Clear ();
+    }
 
-  // Try to match the packet against each traffic class's filters
-  for (uint32_t i = 0; i < m_queueClasses.size (); i++)
+  if (m_classifier.HasOpaqueRules ())
     {
-      // If the packet matches this traffic class's filters, return its index
-      if (m_queueClasses[i]->Match (packet))
-        {
-          return i;
-        }
-      
-      // Keep track of the default traffic class (if any)
-      if (m_queueClasses[i]->IsDefault ())
-        {
-          defaultIndex = i;
-        }
+      return m_classifier.Classify (key);
+    }
+
+  int classIndex;
+  if (!m_flowCache.Lookup (key, classIndex))
+    {
+      classIndex = m_classifier.Classify (key);
+      m_flowCache.Insert (key, classIndex);
     }
+  return classIndex;
+}
 
-  // If no match was found, return the default traffic class index (or -1 if none)
-  return defaultIndex;
+/**
+ * \brief Get the number of packets classified from the flow cache
+ * \return Number of flow cache hits
+ */
+uint64_t
+DiffServ::GetFlowCacheHits () const
+{
+  return m_flowCache.GetHits ();
+}
+
+/**
+ * \brief Get the number of packets that missed the flow cache
+ * \return Number of flow cache misses
+ */
+uint64_t
+DiffServ::GetFlowCacheMisses () const
+{
+  return m_flowCache.GetMisses ();
 }
 
 }
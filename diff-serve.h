@@ -8,17 +8,68 @@
 
 #include "ns3/queue.h"
 #include "ns3/packet.h"
+#include <list>
+#include <ostream>
+#include <string>
 #include <vector>
+#include "arena.h"
 #include "traffic-class.h"
+#include "flow-key.h"
+#include "packet-classifier.h"
+#include "flow-cache.h"
+#include "timer-wheel.h"
+#include "ns3/event-id.h"
+#include "ns3/callback.h"
 
 namespace ns3 {
 
+/**
+ * \brief Scheduling decision returned by DiffServ::Schedule
+ *
+ * Identifies the traffic class that should be served next together with
+ * its head packet, so that the caller can dequeue from that class directly.
+ */
+struct ScheduleResult
+{
+  int index;                 //!< Index of the selected traffic class, or -1 if none
+  Ptr<const Packet> packet;  //!< Head packet of the selected traffic class
+};
+
 /**
  * \brief Base class for Differentiated Services (DiffServ) QoS mechanisms
  *
  * This class provides the foundation for implementing various QoS scheduling
  * algorithms like Strict Priority Queuing (SPQ) and Deficit Round Robin (DRR).
  * It manages multiple traffic classes and handles packet classification.
+ *
+ * Packets are stored in their traffic class, and every packet is also
+ * accounted for in the Queue<Packet> base class. GetNPackets, GetNBytes,
+ * the drop counters and the Enqueue, Dequeue, Drop, PacketsInQueue and
+ * BytesInQueue trace sources therefore reflect the aggregate queue. The
+ * base class only updates those through its own std::list, so every
+ * enqueue allocates one list node there even though the class rings are
+ * preallocated.
+ *
+ * A traffic class may hold a child DiffServ (TrafficClass::SetChild), so
+ * schedulers can be nested, e.g. SPQ between tenants and DRR within each
+ * tenant. Packets are classified level by level and stored in a leaf
+ * class, but only the root, the queue attached to the device, counts them
+ * in its Queue<Packet> base class. Every level keeps the backlog state of
+ * its own scheduler up to date through NotifyEnqueue and NotifyDequeue,
+ * so a dequeue costs one scheduling decision per level.
+ *
+ * Classes with a rate (TrafficClass::SetRate) are shaped by a token
+ * bucket. A class whose head packet does not conform leaves its scheduler
+ * through NotifyDequeue, exactly as if it had emptied, and is parked in a
+ * hierarchical TimerWheel at the tick its bucket refills. One simulator
+ * event per tick, only while some class is parked, hands the released
+ * classes back through NotifyEnqueue. Schedulers therefore never see, and
+ * never skip over, a shaped-out class.
+ *
+ * A DiffServ owns its traffic classes, their filters and the elements of
+ * those filters. Objects created in its Arena (GetArena) are laid out
+ * together and released with it in one shot; objects allocated with new
+ * are deleted by the destructor, once each even if shared.
  */
 class DiffServ : public Queue<Packet>
 {
@@ -55,39 +106,363 @@ public:
   /**
    * \brief Peek at the next packet to be dequeued without removing it
    * \return The next packet to be dequeued, or nullptr if no packet is available
+   *
+   * The packet is the one stored in its traffic class, not a copy. The
+   * scheduling decision is kept until the next enqueue or dequeue, so a
+   * Peek followed by a Dequeue runs the scheduler only once. If the AQM
+   * of its class drops the packet at dequeue, Dequeue returns the next
+   * one instead.
    */
   Ptr<const Packet> Peek () const override;
+
+  /**
+   * \brief Enqueue a burst of packets into their traffic classes
+   * \param packets First packet of the burst
+   * \param count Number of packets in the burst
+   * \return Number of packets enqueued; the others were dropped
+   *
+   * Each packet is handled as by Enqueue, except that a packet of the
+   * same flow as the packet before it reuses its parsed class instead of
+   * classifying again. Must be called on the root scheduler.
+   */
+  uint32_t EnqueueBatch (const Ptr<Packet>* packets, uint32_t count);
+
+  /**
+   * \brief Dequeue packets until a packet or byte limit is reached
+   * \param maxPackets Largest number of packets to dequeue
+   * \param maxBytes Largest number of bytes to dequeue, or 0 for no byte limit
+   * \param packets Vector the dequeued packets are appended to
+   * \return Number of packets dequeued
+   *
+   * The packets and their order are those of as many Dequeue calls, but
+   * the scheduler decides once per run of packets of a class: the class
+   * it selects is served for as long as GetBurstBudget allows. Stops
+   * before the packet that would exceed maxBytes, whose scheduling
+   * decision is kept as after a Peek. Must be called on the root
+   * scheduler.
+   */
+  uint32_t DequeueBatch (uint32_t maxPackets, uint32_t maxBytes, std::vector<Ptr<Packet>>& packets);
   
   /**
    * \brief Get all traffic classes
    * \return Vector of traffic classes
    */
-  std::vector<TrafficClass*> GetClasses () const;
+  const std::vector<TrafficClass*>& GetClasses () const;
+
+  /**
+   * \brief Record that a class or filter of this scheduler changed
+   *
+   * The classifier and the flow cache are rebuilt at the next Classify.
+   * Other schedulers keep theirs.
+   */
+  void NotifyRulesetChanged ();
+
+  /**
+   * \brief Set how a packet released by the shaper reaches an idle device
+   * \param transmit Callback handing a packet to the device the queue is
+   *        attached to, returning whether the device accepted it
+   *
+   * A device only dequeues when a packet is enqueued or a transmission
+   * ends, so once a Dequeue found every backlogged class waiting for
+   * tokens, the device stays idle. When the shaper then releases a class,
+   * the root takes the packet its scheduler selects and passes it to this
+   * callback. The device enqueues the packet again and, being idle, asks
+   * for it at once; the root gives it back first instead of classifying
+   * it again. The packet passes the Enqueue and Dequeue traces of the
+   * queue twice. Without a callback, sending resumes with the next packet
+   * the device enqueues.
+   */
+  void SetTransmitCallback (Callback<bool, Ptr<Packet>> transmit);
   
+  /**
+   * \brief Print the sojourn-time percentiles of every traffic class
+   * \param os Output stream
+   *
+   * One line per class with the number of dequeued packets and the
+   * p50, p99, p99.9 and maximum sojourn times in microseconds. Classes of
+   * child schedulers follow their parent, labelled parent.child.
+   */
+  void PrintSojournTimes (std::ostream& os) const;
+
+  /**
+   * \brief Get the scheduling decision, running Schedule only if needed
+   * \return The selected traffic class and its head packet
+   */
+  ScheduleResult GetSchedule () const;
+
+  /**
+   * \brief Classify a packet and check that every class on its path accepts it
+   * \param key The parsed header fields of the packet
+   * \param size Packet size in bytes
+   * \return true if the packet can be stored
+   *
+   * Used by DoEnqueue and by the parent TrafficClass of a child scheduler.
+   */
+  bool CanStore (const FlowKey& key, uint32_t size);
+
+  /**
+   * \brief Check whether the class found by the last CanStore makes room by evicting a packet
+   * \param size Set to the size of the packet to evict
+   * \return true if Store will evict a packet
+   */
+  bool GetPendingEviction (uint32_t& size) const;
+
+  /**
+   * \brief Store a packet in the class found by the last CanStore
+   * \param key The parsed header fields of the packet
+   * \param packet Packet to store
+   * \param handle Position of the packet in the root base-class container
+   * \return The descriptor of a packet evicted to make room, whose packet
+   *         is nullptr if none was
+   */
+  QueueSlot Store (const FlowKey& key, Ptr<Packet> packet, std::list<Ptr<Packet>>::const_iterator handle);
+
+  /**
+   * \brief Remove the packet selected by the scheduler
+   * \return The descriptor of the packet; a packet must be available
+   */
+  QueueSlot TakeScheduled ();
+
   /**
    * \brief Schedule the next packet to be dequeued
-   * \return The next packet to be dequeued, or nullptr if no packet is available
+   * \return The selected traffic class and its head packet, or an index of
+   *         -1 if no packet is available
    *
    * This is a pure virtual function that must be implemented by derived classes
    * to define their specific scheduling algorithm.
    */
-  virtual Ptr<const Packet> Schedule () const = 0;
+  virtual ScheduleResult Schedule () const = 0;
   
   /**
    * \brief Classify a packet into a traffic class
-   * \param p Packet to classify
+   * \param key The parsed header fields of the packet to classify
    * \return Index of the traffic class that matches the packet, or -1 if no match
+   *
+   * The filters of all classes are compiled into a PacketClassifier, which
+   * is rebuilt the first time a packet is classified after a class, filter
+   * or filter element was added. Results are kept in a per-flow FlowCache,
+   * which is cleared on every rebuild; it is bypassed when a filter holds
+   * a custom element.
    */
-  virtual int Classify (Ptr<Packet> p);
+  virtual int Classify (const FlowKey& key);
+
+  /**
+   * \brief Get the number of packets classified from the flow cache
+   * \return Number of flow cache hits
+   */
+  uint64_t GetFlowCacheHits () const;
+
+  /**
+   * \brief Get the number of packets that missed the flow cache
+   * \return Number of flow cache misses
+   */
+  uint64_t GetFlowCacheMisses () const;
   
+  /**
+   * \brief Set the period of the shaper timing wheel
+   * \param tick Granularity at which shaped classes are released (default 100us)
+   */
+  void SetShaperTick (Time tick);
+
+  /**
+   * \brief Get the period of the shaper timing wheel
+   * \return Granularity at which shaped classes are released
+   */
+  Time GetShaperTick () const;
+
+  /**
+   * \brief Set the link-layer framing of the packets given to the queue
+   * \param linkType The framing used by the device the queue is attached to
+   *
+   * With the default, LINK_AUTO, the framing is detected from the first
+   * packet that only one framing fits. Either way the offset of the IP
+   * header is computed once and used for every packet.
+   */
+  void SetLinkType (LinkType linkType);
+
+  /**
+   * \brief Get the link-layer framing of the packets given to the queue
+   * \return The link type, or LINK_AUTO if not known yet
+   */
+  LinkType GetLinkType () const;
+
   /**
    * \brief Add a traffic class to the DiffServ queue
    * \param trafficClass Pointer to the traffic class to add
+   *
+   * The limits of the class must be set before it is added: the maximum
+   * size of the aggregate queue is set to the sum of the class limits.
+   * The queue takes ownership of the class, its filters and their
+   * elements, which must not belong to another queue.
    */
   virtual void AddClass (TrafficClass* trafficClass);
+
+  /**
+   * \brief Get the arena owning the classification objects of this queue
+   * \return The arena, from which classes, filters and filter elements
+   *         may be created instead of with new
+   */
+  Arena& GetArena ();
+
+protected:
+  /**
+   * \brief Notify the scheduler that a packet was added to a traffic class
+   * \param index Index of the traffic class the packet was enqueued into
+   *
+   * Called after every successful enqueue. Schedulers that keep per-class
+   * backlog state override this; the default implementation does nothing.
+   */
+  virtual void NotifyEnqueue (uint32_t index);
+
+  /**
+   * \brief Notify the scheduler that a packet left a traffic class
+   * \param index Index of the traffic class the packet was dequeued from
+   * \param size Size of the dequeued packet in bytes, or 0 if the AQM of
+   *        the class dropped it
+   *
+   * Called after every successful dequeue or remove. Schedulers that keep
+   * per-class backlog state override this and keep the class only while
+   * IsReady; the default implementation does nothing.
+   */
+  virtual void NotifyDequeue (uint32_t index, uint32_t size);
+
+  /**
+   * \brief Get how long a selected class may be served without a new decision
+   * \param index Index of the traffic class Schedule just selected
+   * \return Bytes the class may send while it stays ready, its first
+   *         packet included, with the same result as scheduling again
+   *         before each packet
+   *
+   * Used by DequeueBatch. The default, 0, runs Schedule before every packet.
+   */
+  virtual uint32_t GetBurstBudget (uint32_t index) const;
+
+  /**
+   * \brief Check whether a class takes part in scheduling
+   * \param index Index of the traffic class
+   * \return true if the class has a packet that may be sent now
+   *
+   * A class is ready from the NotifyEnqueue that announces it until it is
+   * empty or held back by its shaper.
+   */
+  bool IsReady (uint32_t index) const;
+
+  /**
+   * \brief Discard the cached scheduling decision
+   *
+   * Enqueue, dequeue and AddClass already do this. Derived classes call
+   * it when their scheduling state changes for any other reason.
+   */
+  void InvalidateSchedule ();
   
 private:
+  /**
+   * \brief Scheduling state of a traffic class
+   */
+  enum ClassState : uint8_t
+  {
+    CLASS_IDLE,     //!< Not known to the scheduler
+    CLASS_ACTIVE,   //!< Known to the scheduler, IsReady
+    CLASS_PARKED    //!< Waiting in the shaper wheel for tokens
+  };
+
+  Arena m_arena;                             //!< Owns the objects created through GetArena
   std::vector<TrafficClass*> m_queueClasses; //!< Traffic classes
+  PacketClassifier m_classifier;             //!< Classifier compiled from the class filters
+  uint64_t m_rulesetVersion;                 //!< Counts changes to the classes and their filters
+  uint64_t m_classifierVersion;              //!< Ruleset version m_classifier was built from
+  FlowCache m_flowCache;                     //!< Class index of recently seen flows
+  LinkType m_linkType;                       //!< Framing of the enqueued packets
+  uint32_t m_l3Offset;                       //!< Offset of the IP header in the enqueued packets
+  mutable ScheduleResult m_scheduled;        //!< Cached result of Schedule
+  mutable bool m_scheduleValid;              //!< Whether m_scheduled is up to date
+  int m_pendingClass;                        //!< Class found by the last CanStore
+  std::vector<ClassState> m_classState;      //!< Scheduling state of each class
+  TimerWheel m_shaperWheel;                  //!< Parked classes by release tick
+  Time m_shaperTick;                         //!< Period of the shaper wheel
+  EventId m_shaperEvent;                     //!< Next tick of the shaper wheel
+  std::vector<uint32_t> m_expired;           //!< Classes released by the current tick
+  DiffServ* m_parent;                        //!< Scheduler holding this one, if any
+  uint32_t m_parentIndex;                    //!< Index of the node class in m_parent
+  Callback<bool, Ptr<Packet>> m_transmit;    //!< Hands a released packet to an idle device
+  bool m_deviceIdle;                         //!< Whether the last Dequeue found no packet
+  EventId m_restartEvent;                    //!< Pending restart of the idle device
+  Ptr<Packet> m_handoff;                     //!< Packet RestartDevice is handing to the device
+  bool m_handedBack;                         //!< Whether the device enqueued m_handoff again
+  std::list<Ptr<Packet>>::const_iterator m_handoffHandle; //!< Position of the handed back packet
+
+  /**
+   * \brief Hand the packet the scheduler selects to the idle device
+   */
+  void RestartDevice ();
+
+  /**
+   * \brief Get the classification fields of a packet given to the root
+   * \param packet The packet
+   * \return The parsed header fields, only the length if the framing is unknown
+   */
+  FlowKey ParseKey (Ptr<const Packet> packet);
+
+  /**
+   * \brief Check that every class on the path of a packet accepts it
+   * \param key The parsed header fields of the packet
+   * \param size Packet size in bytes
+   * \return true if the class found by the last Classify, and its children, accept it
+   */
+  bool CanStorePending (const FlowKey& key, uint32_t size);
+
+  /**
+   * \brief Enqueue a packet into the class found by the last Classify
+   * \param packet Packet to enqueue
+   * \param key The parsed header fields of the packet
+   * \return true if the packet was successfully enqueued
+   */
+  bool EnqueueClassified (Ptr<Packet> packet, const FlowKey& key);
+
+  /**
+   * \brief Remove the next packet of a class
+   * \param index Index of a class the scheduler selected
+   * \return The descriptor of the packet
+   */
+  QueueSlot TakeFrom (uint32_t index);
+
+  /**
+   * \brief Check whether a class has a packet its scheduler could reach
+   * \param index Index of the traffic class
+   * \return true if the class, or the child scheduler of a node, has one
+   */
+  bool HasBacklog (uint32_t index) const;
+
+  /**
+   * \brief Hand an idle class to the scheduler, or park it if it has no tokens
+   * \param index Index of the traffic class
+   * \return true if the class became active
+   */
+  bool ActivateClass (uint32_t index);
+
+  /**
+   * \brief Hold a class back until its bucket has the tokens for its head packet
+   * \param index Index of the traffic class, with updated tokens
+   */
+  void ParkClass (uint32_t index);
+
+  /**
+   * \brief Release the parked classes whose tick has come
+   */
+  void ShaperTick ();
+
+  /**
+   * \brief Activate a class and the scheduler nodes above it
+   * \param index Index of the traffic class
+   */
+  void WakeClass (uint32_t index);
+
+  /**
+   * \brief Print one sojourn-time line per class, then the lines of its children
+   * \param os Output stream
+   * \param prefix Label of the parent class followed by a dot, or empty at the root
+   */
+  void PrintSojournRows (std::ostream& os, const std::string& prefix) const;
   
   /**
    * \brief Internal implementation of Enqueue
@@ -1,6 +1,6 @@
 /*
  * This program implements a Quality of Service (QoS) simulation using
- * either Strict Priority Queuing (SPQ) or Deficit Round Robin (DRR)
+ * Strict Priority Queuing (SPQ), Deficit Round Robin (DRR), WF2Q+ or PIFO
  * scheduling algorithms. It reads configuration from a JSON file and
  * sets up a client-router-server topology to demonstrate packet
  * scheduling behavior.
@@ -24,7 +24,7 @@ namespace ns3 {
  * \brief Main function for the QoS simulation
  *
  * This function initializes the simulation based on a configuration file
- * that specifies either SPQ or DRR as the QoS mechanism, along with
+ * that specifies SPQ, DRR, WF2Q+ or PIFO as the QoS mechanism, along with
  * traffic class parameters.
  *
  * \param argc Number of command line arguments
@@ -66,7 +66,7 @@ main(int argc, char *argv[])
   // Build the topology (client-router-server) and install protocols
   validator.InitializeTopology ();
 
-  // Initialize the selected QoS mechanism (SPQ or DRR) with traffic classes and filters
+  // Initialize the selected QoS mechanism (SPQ, DRR, WF2Q+ or PIFO) with traffic classes and filters
   validator.InitializeQoSMechanism ();
 
   // Install UDP server and client applications based on the configuration
@@ -75,6 +75,10 @@ main(int argc, char *argv[])
   // Run the simulation
   Simulator::Stop(Seconds(40));
   Simulator::Run ();
+
+  // Report the per-class sojourn-time percentiles and flow cache counters
+  validator.PrintStatistics (std::cout);
+
   Simulator::Destroy ();
 
   std::cout << "Simulation completed successfully." << std::endl;
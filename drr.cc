@@ -4,152 +4,216 @@
  */
 
 #include "drr.h"
-#include <iostream>
+#include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 
 /**
- * \brief Constructor - initializes the current queue index to 0
+ * \brief Constructor - starts with an empty active list and an
+ * Ethernet-sized base quantum
  */
 DRR::DRR ()
-  : m_currentQueueIndex (0)
+  : m_baseQuantum (1500),
+    m_head (NONE),
+    m_tail (NONE)
 {
 }
 
 /**
- * \brief Dequeue the packet selected by the DRR scheduling logic
- * \return Dequeued packet or nullptr if none available
- *
- * This method dequeues the next scheduled packet and then updates
- * the m_currentQueueIndex and m_creditBalance to reflect the dequeue operation.
+ * \brief Set the quantum given to the lowest-weight class
+ * \param quantum Base quantum in bytes, normally the link MTU
  */
-Ptr<Packet>
-DRR::Dequeue ()
+void
+DRR::SetBaseQuantum (uint32_t quantum)
 {
-  Ptr<Packet> dequeuedPacket = DiffServ::Dequeue ();
+  m_baseQuantum = std::max<uint32_t> (quantum, 1);
+  UpdateQuanta ();
+}
 
-  if (dequeuedPacket)
-    {
-      // Update the current queue index and credit balance after successful dequeue
-      m_currentQueueIndex = m_scheduledQueueIndex;
-      m_creditBalance = m_tempCreditBalance;
-      return dequeuedPacket;
-    }
+/**
+ * \brief Get the quantum given to the lowest-weight class
+ * \return Base quantum in bytes
+ */
+uint32_t
+DRR::GetBaseQuantum () const
+{
+  return m_baseQuantum;
+}
 
-  return nullptr;
+/**
+ * \brief Get the quantum of a traffic class
+ * \param index Index of the traffic class
+ * \return Quantum in bytes added to the class deficit on each round
+ */
+uint32_t
+DRR::GetQuantum (uint32_t index) const
+{
+  return m_quantum[index];
 }
 
 /**
- * \brief Remove a packet from the queue
- * \return The removed packet, or nullptr if no packet is available
+ * \brief Recompute the quantum of every class from the weights
+ *
+ * The lowest positive weight is mapped to the base quantum and every
+ * other class is scaled from it, so the ratio of the quanta equals the
+ * ratio of the weights. Classes without a positive weight get the base
+ * quantum.
  */
-Ptr<Packet>
-DRR::Remove ()
+void
+DRR::UpdateQuanta ()
 {
-  std::vector<TrafficClass*> queueList = GetClasses ();
-  
-  // Check if the scheduled queue is valid and not empty
-  if (m_scheduledQueueIndex >= queueList.size () || queueList[m_scheduledQueueIndex]->IsEmpty ())
+  const std::vector<TrafficClass*>& queueList = GetClasses ();
+
+  double minWeight = 0;
+  for (auto tc : queueList)
     {
-      std::cout << "Active queue is invalid or empty during Remove." << std::endl;
-      return nullptr;
+      if (tc->GetWeight () > 0 && (minWeight == 0 || tc->GetWeight () < minWeight))
+        {
+          minWeight = tc->GetWeight ();
+        }
     }
 
-  // Remove the packet from the scheduled queue
-  Ptr<Packet> packetToRemove = queueList[m_scheduledQueueIndex]->Dequeue ();
-
-  if (packetToRemove != nullptr)
+  for (uint32_t i = 0; i < queueList.size (); i++)
     {
-      std::cout << "Got removed: " << packetToRemove->GetSize () << std::endl;
-      std::cout << "Removed from queue index: " << m_scheduledQueueIndex << std::endl;
-
-      // Update the current queue index and credit balance after successful removal
-      m_currentQueueIndex = m_scheduledQueueIndex;
-      m_creditBalance = m_tempCreditBalance;
+      double weight = queueList[i]->GetWeight ();
+      if (weight > 0)
+        {
+          m_quantum[i] = static_cast<uint32_t> (std::lround (m_baseQuantum * weight / minWeight));
+        }
+      else
+        {
+          m_quantum[i] = m_baseQuantum;
+        }
     }
-
-  return packetToRemove;
 }
 
 /**
  * \brief Select the next packet to be dequeued based on DRR algorithm
- * \return Packet at the front of the scheduled queue
+ * \return The scheduled class and the packet at its front
  *
- * This method implements the core DRR scheduling algorithm, which
- * distributes bandwidth fairly among traffic classes based on their weights.
+ * The class at the head of the active list is served while its deficit
+ * covers its head packet. Otherwise it receives its quantum and moves to
+ * the tail of the list. Since the quanta are at least one MTU, this loop
+ * rotates at most once for MTU-sized packets. The rotation only depends
+ * on the deficit and the head packet, so calling Schedule again before
+ * the dequeue selects the same class.
  */
-Ptr<const Packet>
+ScheduleResult
 DRR::Schedule () const
 {
-  // Get traffic class queues
-  std::vector<TrafficClass*> queueList = GetClasses ();
-
-  // Check that there are queues to serve
-  if (queueList.empty ())
+  if (m_head == NONE)
     {
-    //   std::cout << "No queues to serve." << std::endl;
-      return nullptr;
+      return {-1, nullptr};
     }
 
-  // Reset to current deficit
-  m_scheduledQueueIndex = m_currentQueueIndex;
-  m_tempCreditBalance = m_creditBalance;
-
-  // Check first that there are any packets in any queue
-  uint32_t emptyQueueCount = 0;
-  for (uint32_t i = 0; i < queueList.size (); i++)
+  const std::vector<TrafficClass*>& queueList = GetClasses ();
+  while (true)
     {
-      if (queueList[i]->IsEmpty ())
+      if (queueList[m_head]->GetHeadSize () <= m_deficit[m_head])
         {
-          emptyQueueCount++;
+          return {static_cast<int> (m_head), queueList[m_head]->Peek ()};
+        }
+
+      // Not enough credit: grant the quantum and move to the tail
+      m_deficit[m_head] += m_quantum[m_head];
+      if (m_head != m_tail)
+        {
+          uint32_t next = m_next[m_head];
+          m_next[m_tail] = m_head;
+          m_next[m_head] = NONE;
+          m_tail = m_head;
+          m_head = next;
         }
     }
-  
-  if (emptyQueueCount == queueList.size ())
+}
+
+/**
+ * \brief Put a class on the active list when it becomes backlogged
+ * \param index Index of the traffic class the packet was enqueued into
+ *
+ * A newly backlogged class joins the tail of the list with one quantum
+ * of credit.
+ */
+void
+DRR::NotifyEnqueue (uint32_t index)
+{
+  if (m_active[index])
     {
-    //   std::cout << "All queues are empty." << std::endl;
-      return nullptr;
+      return;
     }
 
-  // DRR algorithm implementation
-  while (true)
+  m_active[index] = true;
+  m_deficit[index] = m_quantum[index];
+  m_next[index] = NONE;
+  if (m_tail == NONE)
     {
-      if (!queueList[m_scheduledQueueIndex]->IsEmpty ())
+      m_head = index;
+    }
+  else
+    {
+      m_next[m_tail] = index;
+    }
+  m_tail = index;
+}
+
+/**
+ * \brief Charge a dequeued packet to the deficit of its class
+ * \param index Index of the traffic class the packet was dequeued from
+ * \param size Size of the dequeued packet in bytes
+ *
+ * The scheduled class is always the head of the active list. When it
+ * empties or is shaped out, it leaves the list and its deficit is reset so that idle
+ * classes do not accumulate credit.
+ */
+void
+DRR::NotifyDequeue (uint32_t index, uint32_t size)
+{
+  m_deficit[index] -= std::min (size, m_deficit[index]);
+
+  if (!IsReady (index))
+    {
+      m_deficit[index] = 0;
+      m_active[index] = false;
+      m_head = m_next[index];
+      if (m_head == NONE)
         {
-          // Add the queue's weight to its credit balance
-          m_tempCreditBalance[m_scheduledQueueIndex] =
-            queueList[m_scheduledQueueIndex]->GetWeight () +
-            m_tempCreditBalance[m_scheduledQueueIndex];
-
-          // Check if the queue has enough credit to send the packet
-          uint32_t packetLength = queueList[m_scheduledQueueIndex]->Peek ()->GetSize ();
-          if (packetLength <= m_tempCreditBalance[m_scheduledQueueIndex])
-            {
-              // Deduct the packet size from the credit balance
-              m_tempCreditBalance[m_scheduledQueueIndex] -= packetLength;
-              return queueList[m_scheduledQueueIndex]->Peek ();
-            }
+          m_tail = NONE;
         }
-      
-      // Move to the next queue in round-robin fashion
-      m_scheduledQueueIndex = (m_scheduledQueueIndex + 1) % queueList.size ();
     }
-  
-  // This line should never be reached due to the infinite loop above
-  return nullptr;
+}
+
+/**
+ * \brief Let the selected class send up to its deficit in one batch
+ * \param index Index of the traffic class Schedule just selected
+ * \return The deficit of the class
+ *
+ * Schedule keeps selecting the head of the active list while its deficit
+ * covers its head packet, and NotifyDequeue charges the deficit exactly
+ * as the batch charges this budget.
+ */
+uint32_t
+DRR::GetBurstBudget (uint32_t index) const
+{
+  return m_deficit[index];
 }
 
 /**
  * \brief Add a new TrafficClass to the DRR queue system
  * \param trafficClass Pointer to the TrafficClass instance
  *
- * This method adds a traffic class and initializes its credit balance to zero.
+ * This method adds a traffic class and recomputes the quantum of every
+ * class from the weights.
  */
 void
 DRR::AddClass (TrafficClass* trafficClass)
 {
   DiffServ::AddClass (trafficClass);
-  m_creditBalance.push_back (0);
+  m_quantum.push_back (m_baseQuantum);
+  m_deficit.push_back (0);
+  m_next.push_back (NONE);
+  m_active.push_back (false);
+  UpdateQuanta ();
 }
 
-} 
\ No newline at end of file
+} 
@@ -15,9 +15,14 @@ namespace ns3 {
  * \ingroup diffserv
  * \brief Deficit Round Robin (DRR) scheduler extending DiffServ
  *
- * This class implements the DRR scheduling algorithm, which distributes
- * bandwidth across multiple traffic classes according to their weight.
- * Each traffic class receives service proportional to its configured weight.
+ * This class implements the DRR scheduling algorithm of Shreedhar and
+ * Varghese, which distributes bandwidth across multiple traffic classes
+ * according to their weight. Each traffic class receives a quantum of
+ * bytes per round proportional to its configured weight; the class with
+ * the lowest weight receives the base quantum (one MTU), so every class
+ * can send at least one packet per visit. Only backlogged classes are
+ * kept on the active list, which makes each dequeue O(1) regardless of
+ * the weights or the number of idle classes.
  */
 class DRR : public DiffServ
 {
@@ -27,43 +32,81 @@ public:
    */
   DRR ();
 
-  /**
-   * \brief Dequeue the packet selected by the DRR scheduling logic
-   * \return Dequeued packet or nullptr if none available
-   */
-  Ptr<Packet> Dequeue () override;
-
-  /**
-   * \brief Remove a packet from the queue
-   * \return The removed packet, or nullptr if no packet is available
-   */
-  Ptr<Packet> Remove () override;
-
   /**
    * \brief Select the next packet to be dequeued based on DRR algorithm
-   * \return Packet at the front of the scheduled queue
+   * \return The scheduled class and the packet at its front
    *
    * This method implements the core DRR scheduling algorithm, which
    * distributes bandwidth fairly among traffic classes based on their weights.
    */
-  Ptr<const Packet> Schedule () const override;
+  ScheduleResult Schedule () const override;
 
   /**
    * \brief Add a new TrafficClass to the DRR queue system
    * \param trafficClass Pointer to the TrafficClass instance
    *
-   * This method adds a traffic class and initializes its credit balance to zero.
+   * This method adds a traffic class and recomputes the quantum of every
+   * class from the weights.
    */
   void AddClass (TrafficClass* trafficClass) override;
 
+  /**
+   * \brief Set the quantum given to the lowest-weight class
+   * \param quantum Base quantum in bytes, normally the link MTU
+   */
+  void SetBaseQuantum (uint32_t quantum);
+
+  /**
+   * \brief Get the quantum given to the lowest-weight class
+   * \return Base quantum in bytes
+   */
+  uint32_t GetBaseQuantum () const;
+
+  /**
+   * \brief Get the quantum of a traffic class
+   * \param index Index of the traffic class
+   * \return Quantum in bytes added to the class deficit on each round
+   */
+  uint32_t GetQuantum (uint32_t index) const;
+
+protected:
+  /**
+   * \brief Put a class on the active list when it becomes backlogged
+   * \param index Index of the traffic class the packet was enqueued into
+   */
+  void NotifyEnqueue (uint32_t index) override;
+
+  /**
+   * \brief Charge a dequeued packet to the deficit of its class
+   * \param index Index of the traffic class the packet was dequeued from
+   * \param size Size of the dequeued packet in bytes
+   */
+  void NotifyDequeue (uint32_t index, uint32_t size) override;
+
+  /**
+   * \brief Let the selected class send up to its deficit in one batch
+   * \param index Index of the traffic class Schedule just selected
+   * \return The deficit of the class
+   */
+  uint32_t GetBurstBudget (uint32_t index) const override;
+
 private:
-  u_int32_t m_baseQuantum;
-  uint32_t m_currentQueueIndex;              //!< Currently active queue index
-  mutable uint32_t m_scheduledQueueIndex;    //!< Candidate queue during scheduling
-  std::vector<uint32_t> m_creditBalance;     //!< Deficit counters for each queue
-  mutable std::vector<uint32_t> m_tempCreditBalance; //!< Working copy during Schedule
+  /**
+   * \brief Recompute the quantum of every class from the weights
+   */
+  void UpdateQuanta ();
+
+  static constexpr uint32_t NONE = 0xffffffff; //!< End-of-list marker
+
+  uint32_t m_baseQuantum;                    //!< Quantum of the lowest-weight class (bytes)
+  std::vector<uint32_t> m_quantum;           //!< Quantum of each class (bytes)
+  mutable std::vector<uint32_t> m_deficit;   //!< Deficit counters for each class
+  mutable std::vector<uint32_t> m_next;      //!< Next class on the active list
+  std::vector<bool> m_active;                //!< Whether each class is on the active list
+  mutable uint32_t m_head;                   //!< Class currently being served
+  mutable uint32_t m_tail;                   //!< Last class on the active list
 };
 
 } // namespace ns3
 
-#endif // DRR_H
\ No newline at end of file
+#endif // DRR_H
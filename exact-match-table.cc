@@ -0,0 +1,113 @@
+/*
+ * This program implements an open-addressing hash table from header
+ * field values to classifier rules.
+ */
+
+#include "exact-match-table.h"
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates an empty table
+ */
+ExactMatchTable::ExactMatchTable ()
+  : m_entries (8, Entry {{}, NONE}),
+    m_size (0)
+{
+}
+
+/**
+ * \brief Hash a key
+ * \param key The masked field values
+ * \return Hash value
+ */
+uint32_t
+ExactMatchTable::Hash (const Key& key)
+{
+  uint64_t hash = 0x9e3779b97f4a7c15ULL;
+  for (uint32_t value : key)
+    {
+      hash = (hash ^ value) * 0xff51afd7ed558ccdULL;
+    }
+  return static_cast<uint32_t> (hash ^ (hash >> 32));
+}
+
+/**
+ * \brief Double the capacity and reinsert every entry
+ */
+void
+ExactMatchTable::Grow ()
+{
+  std::vector<Entry> old (m_entries.size () * 2, Entry {{}, NONE});
+  old.swap (m_entries);
+  m_size = 0;
+  for (const Entry& entry : old)
+    {
+      if (entry.value != NONE)
+        {
+          Insert (entry.key, entry.value);
+        }
+    }
+}
+
+/**
+ * \brief Add a key
+ * \param key The masked field values
+ * \param value The rule number; an existing entry for the key is kept
+ */
+void
+ExactMatchTable::Insert (const Key& key, uint32_t value)
+{
+  if (2 * (m_size + 1) > m_entries.size ())
+    {
+      Grow ();
+    }
+
+  uint32_t mask = m_entries.size () - 1;
+  for (uint32_t i = Hash (key) & mask; ; i = (i + 1) & mask)
+    {
+      Entry& entry = m_entries[i];
+      if (entry.value == NONE)
+        {
+          entry.key = key;
+          entry.value = value;
+          m_size++;
+          return;
+        }
+      if (entry.key == key)
+        {
+          return;
+        }
+    }
+}
+
+/**
+ * \brief Look up a key
+ * \param key The masked field values
+ * \return The rule number, or NONE if the key is not present
+ */
+uint32_t
+ExactMatchTable::Find (const Key& key) const
+{
+  uint32_t mask = m_entries.size () - 1;
+  for (uint32_t i = Hash (key) & mask; ; i = (i + 1) & mask)
+    {
+      const Entry& entry = m_entries[i];
+      if (entry.value == NONE || entry.key == key)
+        {
+          return entry.value;
+        }
+    }
+}
+
+/**
+ * \brief Get the number of keys
+ * \return Number of keys
+ */
+uint32_t
+ExactMatchTable::GetSize () const
+{
+  return m_size;
+}
+
+} // namespace ns3
@@ -0,0 +1,83 @@
+/*
+ * This program implements an open-addressing hash table from header
+ * field values to classifier rules.
+ */
+
+#ifndef EXACT_MATCH_TABLE_H
+#define EXACT_MATCH_TABLE_H
+
+#include "flow-key.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Open-addressing hash table from field values to a rule number
+ *
+ * Used by PacketClassifier for each tuple of rules. Entries are stored
+ * inline in a power-of-two array with linear probing and a load factor
+ * of at most one half, so a lookup is normally a single cache line
+ * access and never follows a pointer.
+ */
+class ExactMatchTable
+{
+public:
+  static constexpr uint32_t NONE = 0xffffffff;     //!< Marks an empty entry / missing key
+  typedef std::array<uint32_t, FIELD_COUNT> Key;   //!< Masked value of every field
+
+  /**
+   * \brief Constructor - creates an empty table
+   */
+  ExactMatchTable ();
+
+  /**
+   * \brief Add a key
+   * \param key The masked field values
+   * \param value The rule number; an existing entry for the key is kept
+   */
+  void Insert (const Key& key, uint32_t value);
+
+  /**
+   * \brief Look up a key
+   * \param key The masked field values
+   * \return The rule number, or NONE if the key is not present
+   */
+  uint32_t Find (const Key& key) const;
+
+  /**
+   * \brief Get the number of keys
+   * \return Number of keys
+   */
+  uint32_t GetSize () const;
+
+private:
+  /**
+   * \brief A key and its rule number
+   */
+  struct Entry
+  {
+    Key key;               //!< The masked field values
+    uint32_t value;        //!< Rule number, or NONE if the entry is empty
+  };
+
+  /**
+   * \brief Hash a key
+   * \param key The masked field values
+   * \return Hash value
+   */
+  static uint32_t Hash (const Key& key);
+
+  /**
+   * \brief Double the capacity and reinsert every entry
+   */
+  void Grow ();
+
+  std::vector<Entry> m_entries;  //!< Entry array, capacity a power of two
+  uint32_t m_size;               //!< Number of keys
+};
+
+} // namespace ns3
+
+#endif // EXACT_MATCH_TABLE_H
@@ -0,0 +1,48 @@
+/*
+ * This program implements a filter element that matches packets
+ * based on the DSCP code point of their IPv4 header.
+ */
+
+#include "filter-element-dscp.h"
+
+namespace ns3 {
+
+/**
+ * \brief Constructor
+ * \param dscp Code point to match (0-63, the upper six bits of the TOS byte)
+ */
+FilterElementDscp::FilterElementDscp (uint8_t dscp) 
+  : m_dscp (dscp & 0x3f)
+{
+}
+
+/**
+ * \brief Check if packet's DSCP code point matches the configured one
+ * \param key The parsed header fields of the packet to check
+ * \return true if the packet is IPv4 and its code point equals m_dscp
+ */
+bool
+FilterElementDscp::match (const FlowKey& key) const
+{
+  // Without an IPv4 header there is no code point
+  if (!key.hasIpv4)
+    {
+      return false;
+    }
+
+  return key.dscp == m_dscp;
+}
+
+/**
+ * \brief Describe this element as a single field condition
+ * \param fieldMatch Set to the equivalent condition
+ * \return true
+ */
+bool
+FilterElementDscp::GetFieldMatch (FieldMatch& fieldMatch) const
+{
+  fieldMatch = {FIELD_DSCP, m_dscp, 0x3f};
+  return true;
+}
+
+} // namespace ns3
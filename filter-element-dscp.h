@@ -0,0 +1,46 @@
+/*
+ * This program implements a filter element that matches packets
+ * based on the DSCP code point of their IPv4 header.
+ */
+
+#ifndef FILTER_ELEMENT_DSCP_H
+#define FILTER_ELEMENT_DSCP_H
+
+#include "filter-element.h"
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * \brief Matches IPv4 packets whose DSCP code point equals the given value
+ */
+class FilterElementDscp : public FilterElement
+{
+public:
+  /**
+   * \brief Constructor
+   * \param dscp Code point to match (0-63, the upper six bits of the TOS byte)
+   */
+  FilterElementDscp (uint8_t dscp);
+  
+  /**
+   * \brief Check if packet's DSCP code point matches the configured one
+   * \param key The parsed header fields of the packet to check
+   * \return true if the packet is IPv4 and its code point equals m_dscp
+   */
+  virtual bool match (const FlowKey& key) const override;
+
+  /**
+   * \brief Describe this element as a single field condition
+   * \param fieldMatch Set to the equivalent condition
+   * \return true
+   */
+  virtual bool GetFieldMatch (FieldMatch& fieldMatch) const override;
+
+private:
+  uint8_t m_dscp; //!< Code point to match against
+};
+
+} // namespace ns3
+
+#endif // FILTER_ELEMENT_DSCP_H
@@ -6,9 +6,6 @@
 #include "filter-element-dst-ip.h"
 #include "ns3/log.h"
 #include "ns3/ipv4-header.h"
-#include "ns3/tcp-header.h"
-#include "ns3/udp-header.h"
-#include "ns3/ppp-header.h"
 
 namespace ns3 {
 
@@ -23,34 +20,32 @@ FilterElementDstIp::FilterElementDstIp (Ipv4Address dst)
 
 /**
  * \brief Check if packet's IPv4 destination matches the configured address
- * \param p The packet to check
+ * \param key The parsed header fields of the packet to check
  * \return true if the packet's IPv4 destination equals m_dst
  */
 bool
-FilterElementDstIp::match (Ptr<Packet> p) const
+FilterElementDstIp::match (const FlowKey& key) const
 {
-  // Create a copy of the packet to avoid modifying the original
-  Ptr<Packet> copy = p->Copy ();
-  
-  // First check for PPP header
-  PppHeader pppHeader;
-  if (!copy->PeekHeader (pppHeader))
-    {
-      return false;
-    }
-  
-  // Then check for IPv4 header
-  Ipv4Header ipHeader;
-  if (!copy->PeekHeader (ipHeader))
+  // The packet must carry an IPv4 header
+  if (!key.hasIpv4)
     {
       return false;
     }
 
-  // Extract the destination IP address and compare with our target
-  Ipv4Address dst = ipHeader.GetDestination ();
-  
   // Return true if the destination matches our target
-  return dst == m_dst;
+  return key.dstIp == m_dst;
+}
+
+/**
+ * \brief Describe this element as a single field condition
+ * \param fieldMatch Set to the equivalent condition
+ * \return true
+ */
+bool
+FilterElementDstIp::GetFieldMatch (FieldMatch& fieldMatch) const
+{
+  fieldMatch = {FIELD_DST_IP, m_dst.Get (), 0xffffffff};
+  return true;
 }
 
 }
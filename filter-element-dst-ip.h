@@ -25,10 +25,17 @@ public:
   
   /**
    * \brief Check if packet's IPv4 destination matches the configured address
-   * \param p The packet to check
+   * \param key The parsed header fields of the packet to check
    * \return true if the packet's IPv4 destination equals m_dst
    */
-  virtual bool match (Ptr<Packet> p) const override;
+  virtual bool match (const FlowKey& key) const override;
+
+  /**
+   * \brief Describe this element as a single field condition
+   * \param fieldMatch Set to the equivalent condition
+   * \return true
+   */
+  virtual bool GetFieldMatch (FieldMatch& fieldMatch) const override;
 
 private:
   Ipv4Address m_dst; //!< IPv4 address to match against
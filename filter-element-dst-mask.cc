@@ -1,7 +1,6 @@
 #include "filter-element-dst-mask.h"
 #include "ns3/log.h"
 #include "ns3/ipv4-header.h"
-#include "ns3/ppp-header.h"
 
 namespace ns3 {
 
@@ -12,24 +11,21 @@ FilterElementDstMask::FilterElementDstMask(Ipv4Address network, Ipv4Mask mask)
 
 
 bool
-FilterElementDstMask::match(Ptr<Packet> p) const
+FilterElementDstMask::match(const FlowKey& key) const
 {
-  
-  Ptr<Packet> copy = p->Copy();
-  // Peek the IPv4 header without consuming the packet
-
-  PppHeader pppHeader;
-  if(!copy->RemoveHeader(pppHeader)){
+  if(!key.hasIpv4){
     return false;
   }
 
-  Ipv4Header ipv4Header;
-  if(!copy->RemoveHeader(ipv4Header)){
-    return false;
-  }
+  return key.dstIp.CombineMask(m_mask) == m_network_ip.CombineMask(m_mask);
+}
 
-  Ipv4Address dst = ipv4Header.GetDestination();
-  return dst.CombineMask(m_mask) == m_network_ip.CombineMask(m_mask) ? true : false;
+
+bool
+FilterElementDstMask::GetFieldMatch(FieldMatch& fieldMatch) const
+{
+  fieldMatch = {FIELD_DST_IP, m_network_ip.CombineMask(m_mask).Get(), m_mask.Get()};
+  return true;
 }
 
 }
@@ -24,7 +24,10 @@ public:
   
 
   // Returns true if (dst & mask) == (network & mask)
-  virtual bool match(Ptr<Packet> p) const override;
+  virtual bool match(const FlowKey& key) const override;
+
+  // Describes this element as a single field condition for compiled classifiers
+  virtual bool GetFieldMatch(FieldMatch& fieldMatch) const override;
 
 private:
   Ipv4Address m_network_ip;
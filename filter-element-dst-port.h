@@ -25,10 +25,17 @@ public:
   
   /**
    * \brief Check if packet's destination port matches the configured port
-   * \param p The packet to check
+   * \param key The parsed header fields of the packet to check
    * \return true if the packet's transport destination port equals m_port
    */
-  virtual bool match (Ptr<Packet> p) const override;
+  virtual bool match (const FlowKey& key) const override;
+
+  /**
+   * \brief Describe this element as a single field condition
+   * \param fieldMatch Set to the equivalent condition
+   * \return true
+   */
+  virtual bool GetFieldMatch (FieldMatch& fieldMatch) const override;
 
 private:
   uint16_t m_port; //!< Port number to match against
@@ -3,7 +3,6 @@
 #include "filter-element-protocol.h"
 #include "ns3/log.h"
 #include "ns3/ipv4-header.h"
-#include "ns3/ppp-header.h"
 
 namespace ns3 {
 
@@ -14,24 +13,20 @@ FilterElementProtocol::FilterElementProtocol(uint8_t protocol)
 {}
 
 bool
-FilterElementProtocol::match(Ptr<Packet> p) const
+FilterElementProtocol::match(const FlowKey& key) const
 {
-  
-  Ptr<Packet> copy = p->Copy();
-  
-  PppHeader pppHeader;
-  if(!copy->RemoveHeader(pppHeader)){
+  if(!key.hasIpv4){
     return false;
   }
 
-  Ipv4Header ipv4Header;
-  // Peek at the IPv4 header without consuming the packet
-  if (!copy->RemoveHeader(ipv4Header)) {
-    return false;
-  }
-  
-  uint8_t proto = ipv4Header.GetProtocol();  
-  return proto == m_protocol;
+  return key.protocol == m_protocol;
+}
+
+bool
+FilterElementProtocol::GetFieldMatch(FieldMatch& fieldMatch) const
+{
+  fieldMatch = {FIELD_PROTOCOL, m_protocol, 0xff};
+  return true;
 }
 
 } // namespace ns3
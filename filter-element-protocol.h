@@ -17,7 +17,10 @@ public:
   explicit FilterElementProtocol(uint8_t protocol);
 
   // Returns true if the packet's IP protocol field == m_protocol
-  virtual bool match(Ptr<Packet> p) const override;
+  virtual bool match(const FlowKey& key) const override;
+
+  // Describes this element as a single field condition for compiled classifiers
+  virtual bool GetFieldMatch(FieldMatch& fieldMatch) const override;
 
 private:
   uint8_t m_protocol;
@@ -1,5 +1,4 @@
 #include "filter-element-src-ip.h"
-#include "ns3/ppp-header.h"
 #include <iostream>
 
 namespace ns3 {
@@ -11,26 +10,21 @@ FilterElementSrcIp::FilterElementSrcIp(Ipv4Address src)
 
 
 bool
-FilterElementSrcIp::match(Ptr<Packet> p) const
+FilterElementSrcIp::match(const FlowKey& key) const
 {
-  // Peek at the IPv4 header without removing it
-  Ptr<Packet> copy = p->Copy();
-  PppHeader pppHeader;
-
-  if(!copy->RemoveHeader(pppHeader)){
+  if(!key.hasIpv4){
     return false;
   }
 
-  Ipv4Header ipHeader;
-  
-  // Check if the packet contains an IPv4 header
-  if(!copy->PeekHeader(ipHeader)){
-    return false;
-  }
+  return key.srcIp == m_src;
+}
 
-  Ipv4Address src = ipHeader.GetSource();
-  return src == m_src;
 
+bool
+FilterElementSrcIp::GetFieldMatch(FieldMatch& fieldMatch) const
+{
+  fieldMatch = {FIELD_SRC_IP, m_src.Get(), 0xffffffff};
+  return true;
 }
 
 } // namespace ns3
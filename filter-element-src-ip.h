@@ -21,10 +21,17 @@ public:
  
   /**
    * \brief Check if a packet's source IP matches the configured value
-   * \param p The packet to check
+   * \param key The parsed header fields of the packet to check
    * \return true if the packet's IPv4 source matches m_src, false otherwise
    */
-  virtual bool match(Ptr<Packet> p) const override;
+  virtual bool match(const FlowKey& key) const override;
+
+  /**
+   * \brief Describe this element as a single field condition
+   * \param fieldMatch Set to the equivalent condition
+   * \return true
+   */
+  virtual bool GetFieldMatch(FieldMatch& fieldMatch) const override;
 
 private:
   Ipv4Address m_src;  ///< The source IP address to match against
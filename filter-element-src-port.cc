@@ -3,9 +3,6 @@
 #include "filter-element-src-port.h"
 #include "ns3/log.h"
 #include "ns3/ipv4-header.h"
-#include "ns3/tcp-header.h"
-#include "ns3/udp-header.h"
-#include "ns3/ppp-header.h"
 namespace ns3 {
 
 
@@ -16,45 +13,22 @@ FilterElementSrcPort::FilterElementSrcPort(uint16_t port)
 
 
 bool
-FilterElementSrcPort::match(Ptr<Packet> p) const
+FilterElementSrcPort::match(const FlowKey& key) const
 {
-
-
-  // Make a copy to avoid mutating the original packet
-  Ptr<Packet> copy = p->Copy();
-
-  PppHeader pppHeader;
-  if(!copy->RemoveHeader(pppHeader)){
+  // Only TCP and UDP packets carry ports
+  if(!key.hasPorts){
     return false;
   }
 
-  Ipv4Header ipHeader;
-  if(!copy->RemoveHeader(ipHeader)){
-    return false;
-  }
-
-
-  uint8_t protocol = ipHeader.GetProtocol();
-
-  if(protocol == 17){
-    UdpHeader udpheader;
-    if(!copy->RemoveHeader(udpheader)){
-      return false;
-    }
-    uint16_t port = udpheader.GetDestinationPort();
-    return port == m_port;
-  }
-  else if(protocol == 6){
-    TcpHeader tcpHeader;
-    if(!copy->RemoveHeader(tcpHeader)){
-      return false;
-    }
-    uint16_t port = tcpHeader.GetDestinationPort();
-    return port == m_port;
-  }
+  return key.srcPort == m_port;
+}
 
-  return false;
 
+bool
+FilterElementSrcPort::GetFieldMatch(FieldMatch& fieldMatch) const
+{
+  fieldMatch = {FIELD_SRC_PORT, m_port, 0xffff};
+  return true;
 }
 
 } // namespace ns3
@@ -17,7 +17,10 @@ public:
   FilterElementSrcPort(uint16_t port);
 
   // Returns true if the packet's transport source port == m_port
-  virtual bool match(Ptr<Packet> p) const override;
+  virtual bool match(const FlowKey& key) const override;
+
+  // Describes this element as a single field condition for compiled classifiers
+  virtual bool GetFieldMatch(FieldMatch& fieldMatch) const override;
 
 private:
   uint16_t m_port;
@@ -0,0 +1,21 @@
+/*
+ * This program implements a base class for packet filter elements
+ * that can be combined to create complex packet filters.
+ */
+
+#include "filter-element.h"
+
+namespace ns3 {
+
+/**
+ * \brief Describe this element as a single field condition
+ * \param fieldMatch Unused
+ * \return false: custom elements are only evaluated through match()
+ */
+bool
+FilterElement::GetFieldMatch (FieldMatch& fieldMatch) const
+{
+  return false;
+}
+
+} // namespace ns3
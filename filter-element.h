@@ -7,9 +7,25 @@
 #define FILTER_ELEMENT_H
 
 #include "ns3/packet.h"
+#include "flow-key.h"
 
 namespace ns3 {
 
+/**
+ * \brief A condition on one header field: (field & mask) == value
+ *
+ * Built-in filter elements describe themselves with a FieldMatch so
+ * that classifiers can be compiled from them instead of calling match()
+ * on every element. The packet must also carry the header holding the
+ * field, as reported by FlowKey::HasField.
+ */
+struct FieldMatch
+{
+  FlowField field;         //!< The constrained field
+  uint32_t value;          //!< Required value of the masked field
+  uint32_t mask;           //!< Bits of the field that are compared
+};
+
 /**
  * \brief Base class for filter elements that match specific packet attributes
  *
@@ -27,10 +43,21 @@ public:
 
   /**
    * \brief Check if a packet matches this filter element's condition
-   * \param p The packet to check
+   * \param key The parsed header fields of the packet to check
    * \return true if the packet satisfies this condition, false otherwise
    */
-  virtual bool match (Ptr<Packet> p) const = 0;
+  virtual bool match (const FlowKey& key) const = 0;
+
+  /**
+   * \brief Describe this element as a single field condition
+   * \param fieldMatch Set to the condition when the element can be described
+   * \return true if the element is equivalent to fieldMatch, false if it
+   *         can only be evaluated through match()
+   *
+   * The default implementation returns false, so custom elements are
+   * always evaluated through match().
+   */
+  virtual bool GetFieldMatch (FieldMatch& fieldMatch) const;
 };
 
 } // namespace ns3
@@ -5,12 +5,21 @@
 
 #include "filter.h"
 #include "filter-element.h"
-#include "ns3/tcp-header.h"
-#include "ns3/udp-header.h"
+#include "diff-serve.h"
 #include "ns3/packet.h"
+#include <algorithm>
 
 namespace ns3 {
 
+/**
+ * \brief Default constructor - creates a filter that matches every packet
+ */
+Filter::Filter ()
+  : m_needsIpv4 (false),
+    m_needsPorts (false)
+{
+}
+
 /**
  * \brief Destructor implementation
  */
@@ -20,12 +29,25 @@ Filter::~Filter () = default;
  * \brief Get all filter elements
  * \return Vector of filter elements
  */
-std::vector<FilterElement*> 
-Filter::GetFilters ()
+const std::vector<FilterElement*>& 
+Filter::GetFilters () const
 {
   return m_elements;
 } 
 
+/**
+ * \brief Register a scheduler whose classifier uses this filter
+ * \param owner The DiffServ to notify when an element is added
+ */
+void
+Filter::AddOwner (DiffServ* owner)
+{
+  if (std::find (m_owners.begin (), m_owners.end (), owner) == m_owners.end ())
+    {
+      m_owners.push_back (owner);
+    }
+}
+
 /**
  * \brief Add a filter element to this filter
  * \param element The filter element to add
@@ -34,27 +56,59 @@ void
 Filter::AddFilterElement (FilterElement* element)
 {
   m_elements.push_back (element);
+
+  // Compile a built-in element into a field condition
+  FieldMatch fieldMatch;
+  if (element->GetFieldMatch (fieldMatch))
+    {
+      fieldMatch.value &= fieldMatch.mask;
+      m_conditions.push_back (fieldMatch);
+      m_needsIpv4 = true;
+      if (fieldMatch.field == FIELD_SRC_PORT || fieldMatch.field == FIELD_DST_PORT)
+        {
+          m_needsPorts = true;
+        }
+    }
+  else
+    {
+      m_customElements.push_back (element);
+    }
+  for (DiffServ* owner : m_owners)
+    {
+      owner->NotifyRulesetChanged ();
+    }
 }
 
 /**
  * \brief Check if a packet matches all filter elements
- * \param packet The packet to check
+ * \param key The parsed header fields of the packet to check
  * \return true only if all filter elements match, false otherwise
  */
 bool
-Filter::Match (Ptr<Packet> packet) const
+Filter::Match (const FlowKey& key) const
 {
-  // If no filter elements, match everything
-  if (m_elements.empty ())
+  // The fields of the conditions must be present in the packet
+  if ((m_needsIpv4 && !key.hasIpv4) || (m_needsPorts && !key.hasPorts))
+    {
+      return false;
+    }
+
+  // AND of the compiled conditions: any differing bit is a mismatch
+  std::array<uint32_t, FIELD_COUNT> fields = key.GetFields ();
+  uint32_t mismatch = 0;
+  for (const FieldMatch& condition : m_conditions)
+    {
+      mismatch |= (fields[condition.field] & condition.mask) ^ condition.value;
+    }
+  if (mismatch != 0)
     {
-      return true;
+      return false;
     }
 
-  // Check each filter element - all must match (AND logic)
-  for (const auto& e : m_elements)
+  // Custom elements - all must match (AND logic)
+  for (const FilterElement* e : m_customElements)
     {
-      bool matches = e->match (packet);
-      if (!matches)
+      if (!e->match (key))
         {
           return false;
         }
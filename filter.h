@@ -12,23 +12,34 @@
 
 namespace ns3 {
 
+class DiffServ;
+
 /**
  * \brief A filter that combines multiple filter elements with AND logic
  *
  * This class represents a filter that can be used to match packets based on
  * multiple conditions. A packet matches the filter only if it matches all
  * of the filter elements.
+ *
+ * Built-in elements are compiled, as they are added, into a packed array
+ * of (field, value, mask) conditions (FilterElement::GetFieldMatch). Match
+ * reads the fields of the key once and ANDs the conditions in a loop
+ * without branches or virtual calls. Only custom elements, which cannot
+ * describe themselves as a field condition, are called through match().
  */
 class Filter
 {
 public:
   /**
-   * \brief Default constructor
+   * \brief Default constructor - creates a filter that matches every packet
    */
-  Filter () = default;
+  Filter ();
   
   /**
    * \brief Destructor
+   *
+   * The elements are not deleted here: the owning DiffServ releases them,
+   * as they may be shared or live in its Arena.
    */
   ~Filter ();
 
@@ -36,25 +47,39 @@ public:
    * \brief Add one primitive condition
    * \param element The filter element to add
    *
-   * The Filter takes ownership of the pointer.
+   * The element is owned, like the filter, by the DiffServ the filter
+   * ends up in; see DiffServ::AddClass.
    */
   void AddFilterElement (FilterElement* element);
 
   /**
    * \brief Check if a packet matches all filter elements
-   * \param packet The packet to check
-   * \return true only if **all** FilterElement::match(packet) return true
+   * \param key The parsed header fields of the packet to check
+   * \return true only if **all** FilterElement::match(key) return true
    */
-  bool Match (Ptr<Packet> packet) const;
+  bool Match (const FlowKey& key) const;
 
   /**
    * \brief Get all filter elements
    * \return Vector of filter elements
    */
-  std::vector<FilterElement*> GetFilters ();
+  const std::vector<FilterElement*>& GetFilters () const;
+
+  /**
+   * \brief Register a scheduler whose classifier uses this filter
+   * \param owner The DiffServ to notify when an element is added
+   *
+   * A filter shared by classes of several schedulers notifies each.
+   */
+  void AddOwner (DiffServ* owner);
 
 private:
+  std::vector<DiffServ*> m_owners;         //!< Schedulers whose classifier uses this filter
   std::vector<FilterElement*> m_elements;  //!< The filter elements
+  std::vector<FieldMatch> m_conditions;    //!< Built-in elements, with masked values
+  std::vector<const FilterElement*> m_customElements; //!< Elements evaluated through match()
+  bool m_needsIpv4;                        //!< Whether a condition needs an IPv4 header
+  bool m_needsPorts;                       //!< Whether a condition needs a TCP/UDP header
 };
 
 } // namespace ns3
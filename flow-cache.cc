@@ -0,0 +1,152 @@
+/*
+ * This program implements a per-flow cache of classification results.
+ */
+
+#include "flow-cache.h"
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates an empty cache
+ */
+FlowCache::FlowCache ()
+  : m_entries (SETS * WAYS, Entry {}),
+    m_hits (0),
+    m_misses (0)
+{
+}
+
+/**
+ * \brief Get the first entry of the set a flow maps to
+ * \param key The parsed header fields of the packet
+ * \return Index of the entry
+ */
+uint32_t
+FlowCache::Index (const FlowKey& key)
+{
+  uint64_t hash = key.srcIp.Get ();
+  hash = hash * 0x9e3779b97f4a7c15ULL ^ key.dstIp.Get ();
+  hash = hash * 0x9e3779b97f4a7c15ULL ^ ((uint32_t (key.srcPort) << 16) | key.dstPort);
+  hash = hash * 0x9e3779b97f4a7c15ULL ^ ((uint32_t (key.protocol) << 8) | key.dscp);
+  hash *= 0x9e3779b97f4a7c15ULL;
+  return (static_cast<uint32_t> (hash >> 32) & (SETS - 1)) * WAYS;
+}
+
+/**
+ * \brief Get the flag bits of a flow
+ * \param key The parsed header fields of the packet
+ * \return Flag bits, including VALID
+ */
+uint8_t
+FlowCache::Flags (const FlowKey& key)
+{
+  return VALID | (key.hasIpv4 ? HAS_IPV4 : 0) | (key.hasPorts ? HAS_PORTS : 0);
+}
+
+/**
+ * \brief Check whether an entry holds a flow
+ * \param entry The entry to check
+ * \param key The parsed header fields of the packet
+ * \param flags Flag bits of the flow
+ * \return true if the entry holds the flow
+ */
+bool
+FlowCache::Holds (const Entry& entry, const FlowKey& key, uint8_t flags)
+{
+  return entry.flags == flags
+         && entry.srcIp == key.srcIp.Get () && entry.dstIp == key.dstIp.Get ()
+         && entry.srcPort == key.srcPort && entry.dstPort == key.dstPort
+         && entry.protocol == key.protocol && entry.dscp == key.dscp;
+}
+
+/**
+ * \brief Look up the class of a flow and count a hit or a miss
+ * \param key The parsed header fields of the packet
+ * \param classIndex Set to the cached class index on a hit
+ * \return true on a hit
+ */
+bool
+FlowCache::Lookup (const FlowKey& key, int& classIndex)
+{
+  Entry* set = &m_entries[Index (key)];
+  uint8_t flags = Flags (key);
+  for (uint32_t way = 0; way < WAYS; way++)
+    {
+      if (Holds (set[way], key, flags))
+        {
+          // Move the entry to the front of its set
+          Entry entry = set[way];
+          for (uint32_t i = way; i > 0; i--)
+            {
+              set[i] = set[i - 1];
+            }
+          set[0] = entry;
+
+          m_hits++;
+          classIndex = entry.classIndex;
+          return true;
+        }
+    }
+  m_misses++;
+  return false;
+}
+
+/**
+ * \brief Store the class of a flow
+ * \param key The parsed header fields of the packet
+ * \param classIndex The class index returned by the classifier
+ */
+void
+FlowCache::Insert (const FlowKey& key, int classIndex)
+{
+  // Evict the least recently used entry of the set
+  Entry* set = &m_entries[Index (key)];
+  for (uint32_t i = WAYS - 1; i > 0; i--)
+    {
+      set[i] = set[i - 1];
+    }
+
+  Entry& entry = set[0];
+  entry.srcIp = key.srcIp.Get ();
+  entry.dstIp = key.dstIp.Get ();
+  entry.srcPort = key.srcPort;
+  entry.dstPort = key.dstPort;
+  entry.protocol = key.protocol;
+  entry.dscp = key.dscp;
+  entry.flags = Flags (key);
+  entry.classIndex = classIndex;
+}
+
+/**
+ * \brief Invalidate every entry, keeping the hit and miss counters
+ */
+void
+FlowCache::Clear ()
+{
+  for (Entry& entry : m_entries)
+    {
+      entry.flags = 0;
+    }
+}
+
+/**
+ * \brief Get the number of lookups that hit
+ * \return Number of hits
+ */
+uint64_t
+FlowCache::GetHits () const
+{
+  return m_hits;
+}
+
+/**
+ * \brief Get the number of lookups that missed
+ * \return Number of misses
+ */
+uint64_t
+FlowCache::GetMisses () const
+{
+  return m_misses;
+}
+
+} // namespace ns3
@@ -0,0 +1,117 @@
+/*
+ * This program implements a per-flow cache of classification results.
+ */
+
+#ifndef FLOW_CACHE_H
+#define FLOW_CACHE_H
+
+#include "flow-key.h"
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Two-way set-associative cache from flow to traffic class index
+ *
+ * Entries are keyed by every classification field of a FlowKey (5-tuple
+ * and DSCP) and hold the class index the classifier returned for it, so
+ * packets of a long-lived flow are classified with one hash and at most
+ * two comparisons. Each set keeps its most recently used entry first and
+ * a new flow evicts the least recently used one. The owner must Clear the
+ * cache whenever the classes or filters change.
+ */
+class FlowCache
+{
+public:
+  static constexpr uint32_t SETS = 512;    //!< Number of sets, a power of two
+  static constexpr uint32_t WAYS = 2;      //!< Entries per set
+
+  /**
+   * \brief Constructor - creates an empty cache
+   */
+  FlowCache ();
+
+  /**
+   * \brief Look up the class of a flow and count a hit or a miss
+   * \param key The parsed header fields of the packet
+   * \param classIndex Set to the cached class index on a hit
+   * \return true on a hit
+   */
+  bool Lookup (const FlowKey& key, int& classIndex);
+
+  /**
+   * \brief Store the class of a flow
+   * \param key The parsed header fields of the packet
+   * \param classIndex The class index returned by the classifier
+   */
+  void Insert (const FlowKey& key, int classIndex);
+
+  /**
+   * \brief Invalidate every entry, keeping the hit and miss counters
+   */
+  void Clear ();
+
+  /**
+   * \brief Get the number of lookups that hit
+   * \return Number of hits
+   */
+  uint64_t GetHits () const;
+
+  /**
+   * \brief Get the number of lookups that missed
+   * \return Number of misses
+   */
+  uint64_t GetMisses () const;
+
+private:
+  /**
+   * \brief A cached flow and its class
+   */
+  struct Entry
+  {
+    uint32_t srcIp;        //!< IPv4 source address
+    uint32_t dstIp;        //!< IPv4 destination address
+    uint16_t srcPort;      //!< TCP/UDP source port
+    uint16_t dstPort;      //!< TCP/UDP destination port
+    uint8_t protocol;      //!< IPv4 protocol number
+    uint8_t dscp;          //!< DSCP code point
+    uint8_t flags;         //!< VALID, HAS_IPV4 and HAS_PORTS bits
+    int32_t classIndex;    //!< Cached class index
+  };
+
+  static constexpr uint8_t VALID = 1;      //!< Entry holds a flow
+  static constexpr uint8_t HAS_IPV4 = 2;   //!< FlowKey::hasIpv4
+  static constexpr uint8_t HAS_PORTS = 4;  //!< FlowKey::hasPorts
+
+  /**
+   * \brief Get the first entry of the set a flow maps to
+   * \param key The parsed header fields of the packet
+   * \return Index of the entry
+   */
+  static uint32_t Index (const FlowKey& key);
+
+  /**
+   * \brief Check whether an entry holds a flow
+   * \param entry The entry to check
+   * \param key The parsed header fields of the packet
+   * \param flags Flag bits of the flow
+   * \return true if the entry holds the flow
+   */
+  static bool Holds (const Entry& entry, const FlowKey& key, uint8_t flags);
+
+  /**
+   * \brief Get the flag bits of a flow
+   * \param key The parsed header fields of the packet
+   * \return Flag bits, including VALID
+   */
+  static uint8_t Flags (const FlowKey& key);
+
+  std::vector<Entry> m_entries;  //!< Cache entries
+  uint64_t m_hits;               //!< Number of lookups that hit
+  uint64_t m_misses;             //!< Number of lookups that missed
+};
+
+} // namespace ns3
+
+#endif // FLOW_CACHE_H
@@ -0,0 +1,298 @@
+/*
+ * This program implements a flow key that holds the header fields used
+ * for packet classification, parsed once per packet.
+ */
+
+#include "flow-key.h"
+
+namespace ns3 {
+
+static const uint32_t PPP_HEADER_SIZE = 2;          //!< Size of the PPP header
+static const uint16_t PPP_PROTOCOL_IPV4 = 0x0021;   //!< PPP protocol number of IPv4
+static const uint16_t PPP_PROTOCOL_IPV6 = 0x0057;   //!< PPP protocol number of IPv6
+static const uint32_t ETHERNET_HEADER_SIZE = 14;    //!< Size of the Ethernet II header
+static const uint32_t VLAN_TAG_SIZE = 4;            //!< Size of an 802.1Q tag
+static const uint32_t LLC_SNAP_HEADER_SIZE = 8;     //!< Size of the LLC/SNAP header
+static const uint32_t MAX_L3_OFFSET = ETHERNET_HEADER_SIZE + LLC_SNAP_HEADER_SIZE; //!< Largest framing
+static const uint32_t IPV4_MIN_HEADER_SIZE = 20;    //!< IPv4 header without options
+static const uint32_t IPV4_MAX_HEADER_SIZE = 60;    //!< IPv4 header with the largest options
+static const uint32_t IPV6_HEADER_SIZE = 40;       //!< Fixed IPv6 header
+static const uint32_t IP_LENGTH_FIELDS_SIZE = 6;    //!< Leading IP bytes holding the IPv4 and IPv6 lengths
+static const uint32_t PORTS_SIZE = 4;               //!< TCP/UDP source and destination ports
+static const uint32_t ETHERNET_FCS_SIZE = 4;        //!< Ethernet frame check sequence
+static const uint32_t ETHERNET_MIN_FRAME_SIZE = 64; //!< Ethernet frames are padded up to this size
+
+/**
+ * \brief Constructor - creates an empty key that matches no header fields
+ */
+FlowKey::FlowKey ()
+  : srcPort (0),
+    dstPort (0),
+    protocol (0),
+    dscp (0),
+    length (0),
+    hasIpv4 (false),
+    hasPorts (false)
+{
+}
+
+/**
+ * \brief Parse the classification fields of a packet
+ * \param p Packet to parse (framing + IPv4 with options + optional TCP/UDP)
+ * \param l3Offset Offset of the IP header, i.e. the size of the framing
+ * \return The parsed flow key
+ */
+FlowKey
+FlowKey::Parse (Ptr<const Packet> p, uint32_t l3Offset)
+{
+  FlowKey key;
+  key.length = p->GetSize ();
+  if (l3Offset > MAX_L3_OFFSET)
+    {
+      return key;
+    }
+
+  // Read the leading bytes straight from the packet buffer: enough for the
+  // framing, an IPv4 header with options and the TCP/UDP ports. The
+  // Packet itself is never copied and no header objects are deserialized.
+  uint8_t buffer[MAX_L3_OFFSET + IPV4_MAX_HEADER_SIZE + PORTS_SIZE];
+  uint32_t size = p->CopyData (buffer, l3Offset + IPV4_MAX_HEADER_SIZE + PORTS_SIZE);
+
+  // IPv4 header: version and header length, then the fixed-offset fields.
+  // Other protocols (IPv6, ARP) fail the version check.
+  const uint8_t* ip = buffer + l3Offset;
+  uint32_t ipHeaderSize = (ip[0] & 0x0f) * 4;
+  if (size < l3Offset + IPV4_MIN_HEADER_SIZE || (ip[0] >> 4) != 4
+      || ipHeaderSize < IPV4_MIN_HEADER_SIZE || size < l3Offset + ipHeaderSize)
+    {
+      return key;
+    }
+
+  key.hasIpv4 = true;
+  key.dscp = ip[1] >> 2;
+  key.protocol = ip[9];
+  key.srcIp.Set ((uint32_t (ip[12]) << 24) | (ip[13] << 16) | (ip[14] << 8) | ip[15]);
+  key.dstIp.Set ((uint32_t (ip[16]) << 24) | (ip[17] << 16) | (ip[18] << 8) | ip[19]);
+
+  // TCP and UDP both start with the source and destination ports, which
+  // are only present in the first fragment
+  bool firstFragment = (((ip[6] & 0x1f) << 8) | ip[7]) == 0;
+  if ((key.protocol == 6 || key.protocol == 17) // TCP is 6, UDP is 17
+      && firstFragment && size >= l3Offset + ipHeaderSize + PORTS_SIZE)
+    {
+      const uint8_t* l4 = ip + ipHeaderSize;
+      key.srcPort = (l4[0] << 8) | l4[1];
+      key.dstPort = (l4[2] << 8) | l4[3];
+      key.hasPorts = true;
+    }
+
+  return key;
+}
+
+/**
+ * \brief Get the offset of the IP header for a link type
+ * \param linkType The framing of the packets
+ * \return Size of the framing in bytes (0 for LINK_AUTO)
+ */
+uint32_t
+FlowKey::GetL3Offset (LinkType linkType)
+{
+  switch (linkType)
+    {
+    case LINK_PPP:
+      return PPP_HEADER_SIZE;
+    case LINK_ETHERNET:
+      return ETHERNET_HEADER_SIZE;
+    case LINK_ETHERNET_VLAN:
+      return ETHERNET_HEADER_SIZE + VLAN_TAG_SIZE;
+    case LINK_ETHERNET_LLC:
+      return ETHERNET_HEADER_SIZE + LLC_SNAP_HEADER_SIZE;
+    default:
+      return 0;
+    }
+}
+
+/**
+ * \brief Get the length of the IP packet starting at a given byte
+ * \param ip The first IP_LENGTH_FIELDS_SIZE bytes of the IP header
+ * \return Length of the IP packet given by its header, or 0 if ip does not
+ *         start a valid IPv4 or IPv6 header
+ */
+static uint32_t
+GetIpLength (const uint8_t* ip)
+{
+  uint8_t version = ip[0] >> 4;
+  if (version == 4)
+    {
+      uint32_t headerSize = (ip[0] & 0x0f) * 4;
+      uint32_t totalLength = (ip[2] << 8) | ip[3];
+      return headerSize >= IPV4_MIN_HEADER_SIZE && totalLength >= headerSize ? totalLength : 0;
+    }
+  if (version == 6)
+    {
+      return IPV6_HEADER_SIZE + ((ip[4] << 8) | ip[5]);
+    }
+  return 0;
+}
+
+/**
+ * \brief Check whether a packet is consistent with a framing
+ * \param linkType The framing to check
+ * \param buffer The first bytes of the packet
+ * \param size Number of bytes in buffer
+ * \param packetSize Size of the whole packet
+ * \return true if the framing announces the IP version found after it and
+ *         the IP length accounts for the rest of the packet
+ *
+ * Ethernet frames may end with a frame check sequence and, below the
+ * minimum frame size, with padding after the IP packet.
+ */
+static bool
+FramingFits (LinkType linkType, const uint8_t* buffer, uint32_t size, uint32_t packetSize)
+{
+  uint32_t offset = FlowKey::GetL3Offset (linkType);
+  if (size < offset + IP_LENGTH_FIELDS_SIZE)
+    {
+      return false;
+    }
+  uint32_t ipLength = GetIpLength (buffer + offset);
+  if (ipLength == 0)
+    {
+      return false;
+    }
+  bool ipv4 = (buffer[offset] >> 4) == 4;
+
+  if (linkType == LINK_RAW_IP)
+    {
+      return ipLength == packetSize;
+    }
+  if (linkType == LINK_PPP)
+    {
+      uint16_t protocol = (buffer[0] << 8) | buffer[1];
+      return protocol == (ipv4 ? PPP_PROTOCOL_IPV4 : PPP_PROTOCOL_IPV6) && offset + ipLength == packetSize;
+    }
+
+  // Ethernet: the EtherType in front of the IP header must match its version
+  uint16_t lengthType = (buffer[12] << 8) | buffer[13];
+  if (linkType == LINK_ETHERNET_VLAN && lengthType != 0x8100)
+    {
+      return false;
+    }
+  if (linkType == LINK_ETHERNET_LLC
+      && (lengthType > 1500 || buffer[14] != 0xaa || buffer[15] != 0xaa || buffer[16] != 0x03))
+    {
+      return false;
+    }
+  uint16_t etherType = (buffer[offset - 2] << 8) | buffer[offset - 1];
+  if (etherType != (ipv4 ? 0x0800 : 0x86dd))
+    {
+      return false;
+    }
+  uint32_t frameSize = offset + ipLength;
+  return frameSize == packetSize || frameSize + ETHERNET_FCS_SIZE == packetSize
+         || (frameSize < packetSize && packetSize <= ETHERNET_MIN_FRAME_SIZE + VLAN_TAG_SIZE);
+}
+
+/**
+ * \brief Recognize the framing of a packet
+ * \param p Packet to inspect
+ * \return The link type, or LINK_AUTO if no framing or more than one fits
+ *         the packet
+ */
+LinkType
+FlowKey::DetectLinkType (Ptr<const Packet> p)
+{
+  uint8_t buffer[MAX_L3_OFFSET + IP_LENGTH_FIELDS_SIZE];
+  uint32_t size = p->CopyData (buffer, sizeof (buffer));
+
+  static const LinkType candidates[] = {LINK_RAW_IP, LINK_PPP, LINK_ETHERNET,
+                                        LINK_ETHERNET_VLAN, LINK_ETHERNET_LLC};
+  LinkType found = LINK_AUTO;
+  for (LinkType linkType : candidates)
+    {
+      if (FramingFits (linkType, buffer, size, p->GetSize ()))
+        {
+          if (found != LINK_AUTO)
+            {
+              return LINK_AUTO;
+            }
+          found = linkType;
+        }
+    }
+  return found;
+}
+
+/**
+ * \brief Get a classification field as an unsigned integer
+ * \param field The field to read
+ * \return The field value (addresses in host byte order)
+ */
+uint32_t
+FlowKey::GetField (FlowField field) const
+{
+  switch (field)
+    {
+    case FIELD_SRC_IP:
+      return srcIp.Get ();
+    case FIELD_DST_IP:
+      return dstIp.Get ();
+    case FIELD_SRC_PORT:
+      return srcPort;
+    case FIELD_DST_PORT:
+      return dstPort;
+    case FIELD_PROTOCOL:
+      return protocol;
+    case FIELD_DSCP:
+      return dscp;
+    default:
+      return 0;
+    }
+}
+
+/**
+ * \brief Get every classification field as an unsigned integer
+ * \return The field values indexed by FlowField, as GetField returns them
+ */
+std::array<uint32_t, FIELD_COUNT>
+FlowKey::GetFields () const
+{
+  std::array<uint32_t, FIELD_COUNT> fields;
+  fields[FIELD_SRC_IP] = srcIp.Get ();
+  fields[FIELD_DST_IP] = dstIp.Get ();
+  fields[FIELD_SRC_PORT] = srcPort;
+  fields[FIELD_DST_PORT] = dstPort;
+  fields[FIELD_PROTOCOL] = protocol;
+  fields[FIELD_DSCP] = dscp;
+  return fields;
+}
+
+/**
+ * \brief Check whether a field was present in the packet
+ * \param field The field to check
+ * \return true if the packet carried the header holding the field
+ */
+bool
+FlowKey::HasField (FlowField field) const
+{
+  if (field == FIELD_SRC_PORT || field == FIELD_DST_PORT)
+    {
+      return hasPorts;
+    }
+  return hasIpv4;
+}
+
+/**
+ * \brief Check whether two keys have the same classification fields
+ * \param other The key to compare with
+ * \return true if the 5-tuple, the DSCP and the headers found are equal
+ */
+bool
+FlowKey::IsSameFlow (const FlowKey& other) const
+{
+  return srcIp == other.srcIp && dstIp == other.dstIp
+         && srcPort == other.srcPort && dstPort == other.dstPort
+         && protocol == other.protocol && dscp == other.dscp
+         && hasIpv4 == other.hasIpv4 && hasPorts == other.hasPorts;
+}
+
+} // namespace ns3
@@ -0,0 +1,132 @@
+/*
+ * This program implements a flow key that holds the header fields used
+ * for packet classification, parsed once per packet.
+ */
+
+#ifndef FLOW_KEY_H
+#define FLOW_KEY_H
+
+#include "ns3/packet.h"
+#include "ns3/ipv4-address.h"
+#include <array>
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * \brief Classification fields of a FlowKey, in the order used by
+ *        compiled classifiers
+ */
+enum FlowField
+{
+  FIELD_SRC_IP = 0,        //!< IPv4 source address
+  FIELD_DST_IP,            //!< IPv4 destination address
+  FIELD_SRC_PORT,          //!< TCP/UDP source port
+  FIELD_DST_PORT,          //!< TCP/UDP destination port
+  FIELD_PROTOCOL,          //!< IPv4 protocol number
+  FIELD_DSCP,              //!< DSCP code point
+  FIELD_COUNT              //!< Number of fields
+};
+
+/**
+ * \brief Link-layer framing in front of the IP header
+ */
+enum LinkType
+{
+  LINK_AUTO = 0,           //!< Not known yet, detect from the first unambiguous frame
+  LINK_RAW_IP,             //!< No framing, the packet starts with the IP header
+  LINK_PPP,                //!< 2-byte PPP header (PointToPointNetDevice)
+  LINK_ETHERNET,           //!< 14-byte Ethernet II header (CsmaNetDevice, DIX)
+  LINK_ETHERNET_VLAN,      //!< Ethernet II header with one 802.1Q tag
+  LINK_ETHERNET_LLC        //!< 802.3 header with LLC/SNAP (CsmaNetDevice, LLC)
+};
+
+/**
+ * \brief Header fields of a packet used for classification
+ *
+ * A FlowKey is built once per packet when it enters a DiffServ queue and
+ * is then handed to every Filter and FilterElement, so that the packet is
+ * parsed a single time regardless of how many filter elements are
+ * configured. Parsing reads the fixed-offset header fields from the first
+ * bytes of the packet buffer and never copies the Packet. The link-layer
+ * framing is not parsed per packet: the caller passes the offset of the
+ * IP header for its device, see GetL3Offset and DetectLinkType.
+ */
+struct FlowKey
+{
+  /**
+   * \brief Constructor - creates an empty key that matches no header fields
+   */
+  FlowKey ();
+
+  /**
+   * \brief Parse the classification fields of a packet
+   * \param p Packet to parse (framing + IPv4 with options + optional TCP/UDP)
+   * \param l3Offset Offset of the IP header, i.e. the size of the framing
+   * \return The parsed flow key
+   */
+  static FlowKey Parse (Ptr<const Packet> p, uint32_t l3Offset);
+
+  /**
+   * \brief Get the offset of the IP header for a link type
+   * \param linkType The framing of the packets
+   * \return Size of the framing in bytes (0 for LINK_AUTO)
+   */
+  static uint32_t GetL3Offset (LinkType linkType);
+
+  /**
+   * \brief Recognize the framing of a packet
+   * \param p Packet to inspect
+   * \return The link type, or LINK_AUTO if no framing or more than one fits
+   *         the packet
+   *
+   * Every framing is checked against the packet: its PPP protocol number
+   * or EtherType must announce the IP version found at its offset, and
+   * the IPv4 total length or IPv6 payload length must account for the
+   * rest of the packet, Ethernet padding and FCS aside.
+   */
+  static LinkType DetectLinkType (Ptr<const Packet> p);
+
+  /**
+   * \brief Get a classification field as an unsigned integer
+   * \param field The field to read
+   * \return The field value (addresses in host byte order)
+   */
+  uint32_t GetField (FlowField field) const;
+
+  /**
+   * \brief Get every classification field as an unsigned integer
+   * \return The field values indexed by FlowField, as GetField returns them
+   */
+  std::array<uint32_t, FIELD_COUNT> GetFields () const;
+
+  /**
+   * \brief Check whether a field was present in the packet
+   * \param field The field to check
+   * \return true if the packet carried the header holding the field
+   */
+  bool HasField (FlowField field) const;
+
+  /**
+   * \brief Check whether two keys have the same classification fields
+   * \param other The key to compare with
+   * \return true if the 5-tuple, the DSCP and the headers found are equal
+   *
+   * The length is not compared, so packets of one flow compare equal.
+   */
+  bool IsSameFlow (const FlowKey& other) const;
+
+  Ipv4Address srcIp;       //!< IPv4 source address
+  Ipv4Address dstIp;       //!< IPv4 destination address
+  uint16_t srcPort;        //!< TCP/UDP source port
+  uint16_t dstPort;        //!< TCP/UDP destination port
+  uint8_t protocol;        //!< IPv4 protocol number
+  uint8_t dscp;            //!< DSCP code point (upper six bits of the TOS byte)
+  uint32_t length;         //!< Packet length in bytes, including framing
+  bool hasIpv4;            //!< Whether an IPv4 header was found
+  bool hasPorts;           //!< Whether a TCP or UDP header was found
+};
+
+} // namespace ns3
+
+#endif // FLOW_KEY_H
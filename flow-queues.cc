@@ -0,0 +1,286 @@
+/*
+ * This program implements flow queues sharing a pool of slots, served by
+ * deficit round robin over new and old flows.
+ */
+
+#include "flow-queues.h"
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates an empty structure with no flows and no slots
+ */
+FlowQueues::FlowQueues ()
+  : m_newFlows {NONE, NONE},
+    m_oldFlows {NONE, NONE},
+    m_free (NONE),
+    m_largest (NONE),
+    m_quantum (1)
+{
+}
+
+/**
+ * \brief Drop the contents and set the number of flows and slots
+ * \param flows Number of flow queues
+ * \param slots Number of slots shared by the flows
+ * \param quantum Bytes a flow may send per round, at least 1
+ */
+void
+FlowQueues::Reset (uint32_t flows, uint32_t slots, uint32_t quantum)
+{
+  m_flows.assign (flows, Flow {NONE, NONE, NONE, 0, 0, false});
+  m_size.assign (slots, 0);
+
+  // Every slot starts on the free list
+  m_next.resize (slots);
+  for (uint32_t i = 0; i < slots; i++)
+    {
+      m_next[i] = i + 1 < slots ? i + 1 : NONE;
+    }
+  m_free = slots > 0 ? 0 : NONE;
+
+  m_newFlows = {NONE, NONE};
+  m_oldFlows = {NONE, NONE};
+  m_largest = NONE;
+  m_quantum = quantum > 0 ? quantum : 1;
+}
+
+/**
+ * \brief Get the number of flow queues
+ * \return Number of flows, 0 if the structure is not in use
+ */
+uint32_t
+FlowQueues::GetFlowCount () const
+{
+  return m_flows.size ();
+}
+
+/**
+ * \brief Get the quantum of the flows
+ * \return Bytes a flow may send per round
+ */
+uint32_t
+FlowQueues::GetQuantum () const
+{
+  return m_quantum;
+}
+
+/**
+ * \brief Append a slot to a flow queue
+ * \param flow Index of the flow
+ * \param size Size in bytes of the packet stored in the slot
+ * \return Index of the slot; a free slot must be left
+ */
+uint32_t
+FlowQueues::Push (uint32_t flow, uint32_t size)
+{
+  uint32_t slot = m_free;
+  m_free = m_next[slot];
+  m_next[slot] = NONE;
+  m_size[slot] = size;
+
+  Flow& f = m_flows[flow];
+  if (f.head == NONE)
+    {
+      f.head = slot;
+    }
+  else
+    {
+      m_next[f.tail] = slot;
+    }
+  f.tail = slot;
+  f.bytes += size;
+
+  // A flow in no list is new and starts the round with one quantum
+  if (!f.listed)
+    {
+      f.deficit = m_quantum;
+      Append (m_newFlows, flow);
+    }
+
+  if (m_largest == NONE || f.bytes > m_flows[m_largest].bytes)
+    {
+      m_largest = flow;
+    }
+  return slot;
+}
+
+/**
+ * \brief Get the slot to serve next
+ * \return Index of the slot, or NONE if every flow is empty
+ */
+uint32_t
+FlowQueues::Head () const
+{
+  uint32_t flow = m_newFlows.head != NONE ? m_newFlows.head : m_oldFlows.head;
+  return flow == NONE ? NONE : m_flows[flow].head;
+}
+
+/**
+ * \brief Remove the slot to serve next and charge it to its flow
+ * \return Index of the freed slot, valid until the next Push; the
+ *         structure must not be empty
+ */
+uint32_t
+FlowQueues::Pop ()
+{
+  uint32_t flow = m_newFlows.head != NONE ? m_newFlows.head : m_oldFlows.head;
+  uint32_t slot = Unlink (flow);
+  m_flows[flow].deficit -= m_size[slot];
+  Normalize ();
+  return slot;
+}
+
+/**
+ * \brief Get the flow holding the most bytes
+ * \return Index of the flow, or NONE if every flow is empty
+ */
+uint32_t
+FlowQueues::GetLargestFlow ()
+{
+  // Only a drained candidate forces a scan of the flows
+  if (m_largest == NONE || m_flows[m_largest].bytes == 0)
+    {
+      m_largest = NONE;
+      for (uint32_t flow = 0; flow < m_flows.size (); flow++)
+        {
+          if (m_flows[flow].bytes > 0
+              && (m_largest == NONE || m_flows[flow].bytes > m_flows[m_largest].bytes))
+            {
+              m_largest = flow;
+            }
+        }
+    }
+  return m_largest;
+}
+
+/**
+ * \brief Get the first slot of a flow
+ * \param flow Index of the flow
+ * \return Index of the slot, or NONE if the flow is empty
+ */
+uint32_t
+FlowQueues::GetFlowHead (uint32_t flow) const
+{
+  return m_flows[flow].head;
+}
+
+/**
+ * \brief Remove the first slot of a flow without charging the flow
+ * \param flow Index of the flow, which must not be empty
+ * \return Index of the freed slot, valid until the next Push
+ */
+uint32_t
+FlowQueues::Evict (uint32_t flow)
+{
+  uint32_t slot = Unlink (flow);
+
+  // The flow may have been the one to serve next
+  Normalize ();
+  return slot;
+}
+
+/**
+ * \brief Get the number of bytes queued in a flow
+ * \param flow Index of the flow
+ * \return Number of bytes
+ */
+uint32_t
+FlowQueues::GetFlowBytes (uint32_t flow) const
+{
+  return m_flows[flow].bytes;
+}
+
+/**
+ * \brief Append a flow to a list
+ * \param list The list
+ * \param flow Index of the flow, in no list
+ */
+void
+FlowQueues::Append (FlowList& list, uint32_t flow)
+{
+  m_flows[flow].next = NONE;
+  m_flows[flow].listed = true;
+  if (list.head == NONE)
+    {
+      list.head = flow;
+    }
+  else
+    {
+      m_flows[list.tail].next = flow;
+    }
+  list.tail = flow;
+}
+
+/**
+ * \brief Remove the first flow of a list
+ * \param list The list, which must not be empty
+ * \return Index of the flow
+ */
+uint32_t
+FlowQueues::PopFront (FlowList& list)
+{
+  uint32_t flow = list.head;
+  list.head = m_flows[flow].next;
+  m_flows[flow].listed = false;
+  return flow;
+}
+
+/**
+ * \brief Unlink the first slot of a flow and put it on the free list
+ * \param flow Index of the flow, which must not be empty
+ * \return Index of the slot
+ */
+uint32_t
+FlowQueues::Unlink (uint32_t flow)
+{
+  Flow& f = m_flows[flow];
+  uint32_t slot = f.head;
+  f.head = m_next[slot];
+  f.bytes -= m_size[slot];
+
+  m_next[slot] = m_free;
+  m_free = slot;
+  return slot;
+}
+
+/**
+ * \brief Renew credits and retire empty flows until the head flow can be served
+ */
+void
+FlowQueues::Normalize ()
+{
+  while (true)
+    {
+      bool isNew = m_newFlows.head != NONE;
+      FlowList& list = isNew ? m_newFlows : m_oldFlows;
+      if (list.head == NONE)
+        {
+          return;
+        }
+
+      uint32_t flow = list.head;
+      Flow& f = m_flows[flow];
+      if (f.deficit <= 0)
+        {
+          // Credit used up: next quantum, at the end of the old flows
+          f.deficit += m_quantum;
+          Append (m_oldFlows, PopFront (list));
+        }
+      else if (f.head == NONE)
+        {
+          // An emptied new flow is kept as an old flow while others wait
+          PopFront (list);
+          if (isNew && m_oldFlows.head != NONE)
+            {
+              Append (m_oldFlows, flow);
+            }
+        }
+      else
+        {
+          return;
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,175 @@
+/*
+ * This program implements flow queues sharing a pool of slots, served by
+ * deficit round robin over new and old flows.
+ */
+
+#ifndef FLOW_QUEUES_H
+#define FLOW_QUEUES_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Per-flow FIFO queues of slot indexes with FQ-CoDel style service
+ *
+ * A fixed array of flow queues shares a pool of slots 0..n-1. Each queue
+ * is a FIFO list threaded through the slots, and free slots form a free
+ * list, so a push or a pop only relinks indexes and never allocates. The
+ * caller stores the packets in its own array, at the slot indexes handed
+ * out by Push.
+ *
+ * The queues are served by deficit round robin with the two lists of
+ * FQ-CoDel (RFC 8290): a flow that becomes backlogged joins the new
+ * flows, which are served before the old flows, with one quantum of
+ * credit. A flow that used up its credit gets another quantum and moves
+ * to the end of the old flows. A new flow that empties moves to the old
+ * flows as well, if any, so that a flow cannot stay new by sending one
+ * packet at a time. The lists are brought back to a servable head after
+ * every operation, so Head is a constant-time read and each operation is
+ * O(1) amortized.
+ */
+class FlowQueues
+{
+public:
+  static constexpr uint32_t NONE = 0xffffffff;      //!< No slot or flow
+
+  /**
+   * \brief Constructor - creates an empty structure with no flows and no slots
+   */
+  FlowQueues ();
+
+  /**
+   * \brief Drop the contents and set the number of flows and slots
+   * \param flows Number of flow queues
+   * \param slots Number of slots shared by the flows
+   * \param quantum Bytes a flow may send per round, at least 1
+   */
+  void Reset (uint32_t flows, uint32_t slots, uint32_t quantum);
+
+  /**
+   * \brief Get the number of flow queues
+   * \return Number of flows, 0 if the structure is not in use
+   */
+  uint32_t GetFlowCount () const;
+
+  /**
+   * \brief Get the quantum of the flows
+   * \return Bytes a flow may send per round
+   */
+  uint32_t GetQuantum () const;
+
+  /**
+   * \brief Append a slot to a flow queue
+   * \param flow Index of the flow
+   * \param size Size in bytes of the packet stored in the slot
+   * \return Index of the slot; a free slot must be left
+   */
+  uint32_t Push (uint32_t flow, uint32_t size);
+
+  /**
+   * \brief Get the slot to serve next
+   * \return Index of the slot, or NONE if every flow is empty
+   */
+  uint32_t Head () const;
+
+  /**
+   * \brief Remove the slot to serve next and charge it to its flow
+   * \return Index of the freed slot, valid until the next Push; the
+   *         structure must not be empty
+   */
+  uint32_t Pop ();
+
+  /**
+   * \brief Get the flow holding the most bytes
+   * \return Index of the flow, or NONE if every flow is empty
+   *
+   * The largest flow is tracked as flows grow, so this is exact as of the
+   * last Push, except that flows shrunk since then are not reordered.
+   */
+  uint32_t GetLargestFlow ();
+
+  /**
+   * \brief Get the first slot of a flow
+   * \param flow Index of the flow
+   * \return Index of the slot, or NONE if the flow is empty
+   */
+  uint32_t GetFlowHead (uint32_t flow) const;
+
+  /**
+   * \brief Remove the first slot of a flow without charging the flow
+   * \param flow Index of the flow, which must not be empty
+   * \return Index of the freed slot, valid until the next Push
+   */
+  uint32_t Evict (uint32_t flow);
+
+  /**
+   * \brief Get the number of bytes queued in a flow
+   * \param flow Index of the flow
+   * \return Number of bytes
+   */
+  uint32_t GetFlowBytes (uint32_t flow) const;
+
+private:
+  /**
+   * \brief A FIFO list of flows
+   */
+  struct FlowList
+  {
+    uint32_t head;                      //!< First flow, NONE if empty
+    uint32_t tail;                      //!< Last flow
+  };
+
+  /**
+   * \brief State of one flow queue
+   */
+  struct Flow
+  {
+    uint32_t head;                      //!< First slot, NONE if empty
+    uint32_t tail;                      //!< Last slot
+    uint32_t next;                      //!< Next flow in the same list
+    uint32_t bytes;                     //!< Bytes queued in the flow
+    int64_t deficit;                    //!< Bytes the flow may still send this round
+    bool listed;                        //!< Whether the flow is in a list
+  };
+
+  /**
+   * \brief Append a flow to a list
+   * \param list The list
+   * \param flow Index of the flow, in no list
+   */
+  void Append (FlowList& list, uint32_t flow);
+
+  /**
+   * \brief Remove the first flow of a list
+   * \param list The list, which must not be empty
+   * \return Index of the flow
+   */
+  uint32_t PopFront (FlowList& list);
+
+  /**
+   * \brief Unlink the first slot of a flow and put it on the free list
+   * \param flow Index of the flow, which must not be empty
+   * \return Index of the slot
+   */
+  uint32_t Unlink (uint32_t flow);
+
+  /**
+   * \brief Renew credits and retire empty flows until the head flow can be served
+   */
+  void Normalize ();
+
+  std::vector<Flow> m_flows;            //!< State of each flow
+  std::vector<uint32_t> m_next;         //!< Next slot in the same flow or free list
+  std::vector<uint32_t> m_size;         //!< Packet size of each slot
+  FlowList m_newFlows;                  //!< Flows that became backlogged this round
+  FlowList m_oldFlows;                  //!< Flows that used up a quantum
+  uint32_t m_free;                      //!< First free slot
+  uint32_t m_largest;                   //!< Flow holding the most bytes, NONE if unknown
+  uint32_t m_quantum;                   //!< Bytes a flow may send per round
+};
+
+} // namespace ns3
+
+#endif // FLOW_QUEUES_H
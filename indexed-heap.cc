@@ -0,0 +1,189 @@
+/*
+ * This program implements a binary min-heap of integer identifiers
+ * whose keys can be changed or removed by identifier.
+ */
+
+#include "indexed-heap.h"
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates an empty heap with no identifiers
+ */
+IndexedHeap::IndexedHeap ()
+  : m_size (0)
+{
+}
+
+/**
+ * \brief Grow the range of identifiers, keeping the heap contents
+ * \param n Identifiers range from 0 to n - 1
+ */
+void
+IndexedHeap::Resize (uint32_t n)
+{
+  m_nodes.resize (n, Node {0, NONE});
+  m_pos.resize (n, NONE);
+}
+
+/**
+ * \brief Check whether a node must be above another
+ * \param a First node
+ * \param b Second node
+ * \return true if a orders before b
+ */
+bool
+IndexedHeap::Less (const Node& a, const Node& b)
+{
+  return a.key < b.key || (a.key == b.key && a.id < b.id);
+}
+
+/**
+ * \brief Store a node at a position and record that position
+ * \param pos Position in the heap
+ * \param node The node to store
+ */
+void
+IndexedHeap::Place (uint32_t pos, const Node& node)
+{
+  m_nodes[pos] = node;
+  m_pos[node.id] = pos;
+}
+
+/**
+ * \brief Move a node towards the root until the heap is ordered
+ * \param pos Position of the node
+ */
+void
+IndexedHeap::SiftUp (uint32_t pos)
+{
+  Node node = m_nodes[pos];
+  while (pos > 0)
+    {
+      uint32_t parent = (pos - 1) / 2;
+      if (!Less (node, m_nodes[parent]))
+        {
+          break;
+        }
+      Place (pos, m_nodes[parent]);
+      pos = parent;
+    }
+  Place (pos, node);
+}
+
+/**
+ * \brief Move a node towards the leaves until the heap is ordered
+ * \param pos Position of the node
+ */
+void
+IndexedHeap::SiftDown (uint32_t pos)
+{
+  Node node = m_nodes[pos];
+  while (true)
+    {
+      uint32_t child = 2 * pos + 1;
+      if (child >= m_size)
+        {
+          break;
+        }
+      if (child + 1 < m_size && Less (m_nodes[child + 1], m_nodes[child]))
+        {
+          child++;
+        }
+      if (!Less (m_nodes[child], node))
+        {
+          break;
+        }
+      Place (pos, m_nodes[child]);
+      pos = child;
+    }
+  Place (pos, node);
+}
+
+/**
+ * \brief Insert an identifier
+ * \param id Identifier, not already in the heap
+ * \param key Key of the identifier
+ */
+void
+IndexedHeap::Push (uint32_t id, uint64_t key)
+{
+  Place (m_size, Node {key, id});
+  SiftUp (m_size++);
+}
+
+/**
+ * \brief Remove an identifier
+ * \param id Identifier in the heap
+ */
+void
+IndexedHeap::Remove (uint32_t id)
+{
+  uint32_t pos = m_pos[id];
+  m_pos[id] = NONE;
+  if (--m_size == pos)
+    {
+      return;
+    }
+
+  // Fill the hole with the last node and restore the order around it
+  uint32_t moved = m_nodes[m_size].id;
+  Place (pos, m_nodes[m_size]);
+  SiftUp (pos);
+  SiftDown (m_pos[moved]);
+}
+
+/**
+ * \brief Remove and return the identifier with the smallest key
+ * \return The identifier
+ */
+uint32_t
+IndexedHeap::Pop ()
+{
+  uint32_t id = m_nodes[0].id;
+  Remove (id);
+  return id;
+}
+
+/**
+ * \brief Get the identifier with the smallest key
+ * \return The identifier, or NONE if the heap is empty
+ */
+uint32_t
+IndexedHeap::Top () const
+{
+  return m_size > 0 ? m_nodes[0].id : NONE;
+}
+
+/**
+ * \brief Get the smallest key
+ * \return The key of Top; the heap must not be empty
+ */
+uint64_t
+IndexedHeap::TopKey () const
+{
+  return m_nodes[0].key;
+}
+
+/**
+ * \brief Check whether an identifier is in the heap
+ * \param id Identifier to check
+ * \return true if the identifier is in the heap
+ */
+bool
+IndexedHeap::Contains (uint32_t id) const
+{
+  return m_pos[id] != NONE;
+}
+
+/**
+ * \brief Check whether the heap is empty
+ * \return true if the heap is empty
+ */
+bool
+IndexedHeap::IsEmpty () const
+{
+  return m_size == 0;
+}
+
+} // namespace ns3
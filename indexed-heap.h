@@ -0,0 +1,126 @@
+/*
+ * This program implements a binary min-heap of integer identifiers
+ * whose keys can be changed or removed by identifier.
+ */
+
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Binary min-heap over identifiers 0..n-1 with a position index
+ *
+ * Each identifier is in the heap at most once, with a 64-bit key. The
+ * position of every identifier is tracked, so Remove and Update are
+ * O(log n) without searching. Equal keys are ordered by identifier.
+ * All storage is sized by Resize, so no operation on the heap allocates.
+ */
+class IndexedHeap
+{
+public:
+  static constexpr uint32_t NONE = 0xffffffff; //!< Position of an absent identifier
+
+  /**
+   * \brief Constructor - creates an empty heap with no identifiers
+   */
+  IndexedHeap ();
+
+  /**
+   * \brief Grow the range of identifiers, keeping the heap contents
+   * \param n Identifiers range from 0 to n - 1
+   */
+  void Resize (uint32_t n);
+
+  /**
+   * \brief Insert an identifier
+   * \param id Identifier, not already in the heap
+   * \param key Key of the identifier
+   */
+  void Push (uint32_t id, uint64_t key);
+
+  /**
+   * \brief Remove an identifier
+   * \param id Identifier in the heap
+   */
+  void Remove (uint32_t id);
+
+  /**
+   * \brief Remove and return the identifier with the smallest key
+   * \return The identifier
+   */
+  uint32_t Pop ();
+
+  /**
+   * \brief Get the identifier with the smallest key
+   * \return The identifier, or NONE if the heap is empty
+   */
+  uint32_t Top () const;
+
+  /**
+   * \brief Get the smallest key
+   * \return The key of Top; the heap must not be empty
+   */
+  uint64_t TopKey () const;
+
+  /**
+   * \brief Check whether an identifier is in the heap
+   * \param id Identifier to check
+   * \return true if the identifier is in the heap
+   */
+  bool Contains (uint32_t id) const;
+
+  /**
+   * \brief Check whether the heap is empty
+   * \return true if the heap is empty
+   */
+  bool IsEmpty () const;
+
+private:
+  /**
+   * \brief An identifier and its key
+   */
+  struct Node
+  {
+    uint64_t key;   //!< Key of the identifier
+    uint32_t id;    //!< The identifier
+  };
+
+  /**
+   * \brief Check whether a node must be above another
+   * \param a First node
+   * \param b Second node
+   * \return true if a orders before b
+   */
+  static bool Less (const Node& a, const Node& b);
+
+  /**
+   * \brief Move a node towards the root until the heap is ordered
+   * \param pos Position of the node
+   */
+  void SiftUp (uint32_t pos);
+
+  /**
+   * \brief Move a node towards the leaves until the heap is ordered
+   * \param pos Position of the node
+   */
+  void SiftDown (uint32_t pos);
+
+  /**
+   * \brief Store a node at a position and record that position
+   * \param pos Position in the heap
+   * \param node The node to store
+   */
+  void Place (uint32_t pos, const Node& node);
+
+  std::vector<Node> m_nodes;       //!< Heap array, capacity of every identifier
+  uint32_t m_size;                 //!< Number of nodes in the heap
+  std::vector<uint32_t> m_pos;     //!< Position of each identifier, or NONE
+};
+
+} // namespace ns3
+
+#endif // INDEXED_HEAP_H
@@ -0,0 +1,256 @@
+/*
+ * This program implements a packet classifier compiled from the filters
+ * of a set of traffic classes.
+ */
+
+#include "packet-classifier.h"
+#include "traffic-class.h"
+#include <algorithm>
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates a classifier that matches nothing
+ */
+PacketClassifier::PacketClassifier ()
+  : m_defaultClass (-1)
+{
+  m_dscpRules.fill (NO_RULE);
+}
+
+/**
+ * \brief Compile the filters of a set of traffic classes
+ * \param classes The traffic classes, in classification order
+ */
+void
+PacketClassifier::Build (const std::vector<TrafficClass*>& classes)
+{
+  m_srcPrefixes.Clear ();
+  m_dstPrefixes.Clear ();
+  m_dscpRules.fill (NO_RULE);
+  m_tuples.clear ();
+  m_opaqueRules.clear ();
+  m_ruleClass.clear ();
+  m_defaultClass = -1;
+
+  for (uint32_t i = 0; i < classes.size (); i++)
+    {
+      std::vector<Filter*> filters = classes[i]->GetFilters ();
+
+      // A class without filters matches every packet
+      if (filters.empty ())
+        {
+          AddRule (nullptr, m_ruleClass.size ());
+          m_ruleClass.push_back (i);
+        }
+
+      for (const Filter* filter : filters)
+        {
+          AddRule (filter, m_ruleClass.size ());
+          m_ruleClass.push_back (i);
+        }
+
+      if (classes[i]->IsDefault ())
+        {
+          m_defaultClass = i;
+        }
+    }
+
+  // Probe the tuples holding the earliest rules first
+  std::sort (m_tuples.begin (), m_tuples.end (), [] (const Tuple& a, const Tuple& b) {
+    return a.minRule < b.minRule;
+  });
+}
+
+/**
+ * \brief Compile one filter into a rule
+ * \param filter The filter to compile, or nullptr for a match-all rule
+ * \param rule Rule number of the filter
+ */
+void
+PacketClassifier::AddRule (const Filter* filter, uint32_t rule)
+{
+  FieldValues value {};
+  FieldValues mask {};
+  bool needsIpv4 = false;
+  bool needsPorts = false;
+  uint32_t fields = 0;
+
+  if (filter != nullptr)
+    {
+      for (const FilterElement* element : filter->GetFilters ())
+        {
+          FieldMatch fieldMatch;
+          if (!element->GetFieldMatch (fieldMatch))
+            {
+              // Custom element: the whole filter is evaluated through Match
+              m_opaqueRules.push_back ({rule, filter});
+              return;
+            }
+
+          // Two conditions on overlapping bits must agree, or the rule can never match
+          uint32_t& fieldValue = value[fieldMatch.field];
+          uint32_t& fieldMask = mask[fieldMatch.field];
+          uint32_t newValue = fieldMatch.value & fieldMatch.mask;
+          if ((fieldValue ^ newValue) & fieldMask & fieldMatch.mask)
+            {
+              return;
+            }
+          fieldValue |= newValue;
+          fieldMask |= fieldMatch.mask;
+          fields |= 1u << fieldMatch.field;
+
+          needsIpv4 = true;
+          if (fieldMatch.field == FIELD_SRC_PORT || fieldMatch.field == FIELD_DST_PORT)
+            {
+              needsPorts = true;
+            }
+        }
+    }
+
+  // A prefix on a single address goes into the trie of that address
+  uint32_t field = fields == (1u << FIELD_SRC_IP) ? FIELD_SRC_IP
+                   : fields == (1u << FIELD_DST_IP) ? FIELD_DST_IP
+                   : FIELD_COUNT;
+  if (field != FIELD_COUNT)
+    {
+      uint32_t inverted = ~mask[field];
+      if ((inverted & (inverted + 1)) == 0)
+        {
+          PrefixTrie& trie = field == FIELD_SRC_IP ? m_srcPrefixes : m_dstPrefixes;
+          trie.Insert (value[field], __builtin_popcount (mask[field]), rule);
+          return;
+        }
+    }
+
+  // A rule on the DSCP alone is expanded into the code points it matches
+  if (fields == (1u << FIELD_DSCP))
+    {
+      for (uint32_t dscp = 0; dscp < DSCP_COUNT; dscp++)
+        {
+          if ((dscp & mask[FIELD_DSCP]) == value[FIELD_DSCP])
+            {
+              m_dscpRules[dscp] = std::min (m_dscpRules[dscp], rule);
+            }
+        }
+      return;
+    }
+
+  // Find or create the tuple for this set of masks
+  auto tuple = std::find_if (m_tuples.begin (), m_tuples.end (), [&] (const Tuple& t) {
+    return t.mask == mask && t.needsIpv4 == needsIpv4 && t.needsPorts == needsPorts;
+  });
+  if (tuple == m_tuples.end ())
+    {
+      Tuple newTuple;
+      newTuple.mask = mask;
+      newTuple.fieldCount = 0;
+      for (uint32_t f = 0; f < FIELD_COUNT; f++)
+        {
+          if (mask[f] != 0)
+            {
+              newTuple.fields[newTuple.fieldCount++] = f;
+            }
+        }
+      newTuple.needsIpv4 = needsIpv4;
+      newTuple.needsPorts = needsPorts;
+      newTuple.minRule = rule;
+      m_tuples.push_back (newTuple);
+      tuple = m_tuples.end () - 1;
+    }
+
+  // Rules are added in order, so an existing entry is always the earlier rule
+  tuple->rules.Insert (value, rule);
+}
+
+/**
+ * \brief Classify a packet
+ * \param key The parsed header fields of the packet to classify
+ * \return Index of the matching traffic class, or -1 if no match
+ */
+int
+PacketClassifier::Classify (const FlowKey& key) const
+{
+  uint32_t best = m_ruleClass.size ();
+
+  // First rule among the DSCP-only and single-address prefix rules
+  if (key.hasIpv4)
+    {
+      best = std::min (best, m_dscpRules[key.dscp]);
+      best = std::min (best, m_srcPrefixes.Lookup (key.srcIp.Get ()));
+      best = std::min (best, m_dstPrefixes.Lookup (key.dstIp.Get ()));
+    }
+
+  FieldValues fields = key.GetFields ();
+
+  for (const Tuple& tuple : m_tuples)
+    {
+      // No remaining tuple can hold an earlier rule
+      if (tuple.minRule >= best)
+        {
+          break;
+        }
+      if ((tuple.needsIpv4 && !key.hasIpv4) || (tuple.needsPorts && !key.hasPorts))
+        {
+          continue;
+        }
+
+      // Only the fields the tuple constrains are extracted and masked
+      FieldValues masked {};
+      for (uint8_t i = 0; i < tuple.fieldCount; i++)
+        {
+          uint8_t f = tuple.fields[i];
+          masked[f] = fields[f] & tuple.mask[f];
+        }
+
+      uint32_t rule = tuple.rules.Find (masked);
+      if (rule < best)
+        {
+          best = rule;
+        }
+    }
+
+  // Filters with custom elements only matter if they come first
+  for (const auto& opaque : m_opaqueRules)
+    {
+      if (opaque.first >= best)
+        {
+          break;
+        }
+      if (opaque.second->Match (key))
+        {
+          best = opaque.first;
+          break;
+        }
+    }
+
+  if (best < m_ruleClass.size ())
+    {
+      return m_ruleClass[best];
+    }
+
+  // If no match was found, return the default traffic class index (or -1 if none)
+  return m_defaultClass;
+}
+
+/**
+ * \brief Get the number of tuples probed in the worst case
+ * \return Number of tuples
+ */
+uint32_t
+PacketClassifier::GetTupleCount () const
+{
+  return m_tuples.size ();
+}
+
+/**
+ * \brief Check whether some filters are evaluated through Filter::Match
+ * \return true if a filter contains a custom element
+ */
+bool
+PacketClassifier::HasOpaqueRules () const
+{
+  return !m_opaqueRules.empty ();
+}
+
+} // namespace ns3
@@ -0,0 +1,126 @@
+/*
+ * This program implements a packet classifier compiled from the filters
+ * of a set of traffic classes.
+ */
+
+#ifndef PACKET_CLASSIFIER_H
+#define PACKET_CLASSIFIER_H
+
+#include "exact-match-table.h"
+#include "flow-key.h"
+#include "filter.h"
+#include "prefix-trie.h"
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+class TrafficClass;
+
+/**
+ * \brief Immutable multi-field classifier built from traffic class filters
+ *
+ * Every Filter of every TrafficClass becomes one rule, numbered in the
+ * order DiffServ::Classify used to test them, so the lowest matching rule
+ * wins. Filters made only of built-in elements are compiled into
+ * (field, value, mask) conditions and grouped by tuple, i.e. by the set
+ * of masks they apply. Each tuple is an open-addressing ExactMatchTable
+ * from the masked values of the fields it constrains to the lowest rule
+ * with those values (tuple space search), so a lookup costs one probe per
+ * distinct tuple rather than one test per rule. Exact port, protocol and
+ * address filters all land in full-mask tuples, e.g. any number of
+ * destination port classes are resolved by a single probe. Tuples are
+ * probed in order of their lowest rule and the search stops as soon as
+ * no remaining tuple can hold a better rule.
+ *
+ * Rules that only constrain the source address, or only the destination
+ * address, to a prefix (subnet, mask or exact address filters) are kept
+ * out of the tuples and stored in one Patricia trie per address instead.
+ * A single trie walk then finds the first such rule, however many
+ * prefixes and prefix lengths are configured. Rules on the DSCP alone are
+ * compiled into a 64-entry table indexed by the code point, so a purely
+ * DSCP-based configuration classifies with a single array access.
+ *
+ * Filters containing custom elements cannot be compiled. They are
+ * evaluated through Filter::Match, and only when they precede the best
+ * compiled match. A class without filters matches every packet. If no
+ * rule matches, the last default class is returned, as before.
+ */
+class PacketClassifier
+{
+public:
+  /**
+   * \brief Constructor - creates a classifier that matches nothing
+   */
+  PacketClassifier ();
+
+  /**
+   * \brief Compile the filters of a set of traffic classes
+   * \param classes The traffic classes, in classification order
+   */
+  void Build (const std::vector<TrafficClass*>& classes);
+
+  /**
+   * \brief Classify a packet
+   * \param key The parsed header fields of the packet to classify
+   * \return Index of the matching traffic class, or -1 if no match
+   */
+  int Classify (const FlowKey& key) const;
+
+  /**
+   * \brief Get the number of tuples probed in the worst case
+   * \return Number of tuples
+   */
+  uint32_t GetTupleCount () const;
+
+  /**
+   * \brief Check whether some filters are evaluated through Filter::Match
+   * \return true if a filter contains a custom element
+   *
+   * Custom elements may look at more than the flow fields, e.g. the
+   * packet length, so their result cannot be cached per flow.
+   */
+  bool HasOpaqueRules () const;
+
+private:
+  static constexpr uint32_t DSCP_COUNT = 64;          //!< Number of DSCP code points
+  static constexpr uint32_t NO_RULE = 0xffffffff;     //!< Marks a code point without a rule
+
+  /// Masked values of every classification field
+  typedef ExactMatchTable::Key FieldValues;
+
+  /**
+   * \brief Rules sharing the same masks
+   */
+  struct Tuple
+  {
+    FieldValues mask;                   //!< Mask applied to each field
+    uint8_t fields[FIELD_COUNT];        //!< Fields with a non-zero mask
+    uint8_t fieldCount;                 //!< Number of entries in fields
+    bool needsIpv4;                     //!< Whether the rules need an IPv4 header
+    bool needsPorts;                    //!< Whether the rules need a TCP/UDP header
+    uint32_t minRule;                   //!< Lowest rule in the tuple
+    ExactMatchTable rules;              //!< Masked values to lowest rule
+  };
+
+  /**
+   * \brief Compile one filter into a rule
+   * \param filter The filter to compile, or nullptr for a match-all rule
+   * \param rule Rule number of the filter
+   */
+  void AddRule (const Filter* filter, uint32_t rule);
+
+  PrefixTrie m_srcPrefixes;                                     //!< Source-prefix-only rules
+  PrefixTrie m_dstPrefixes;                                     //!< Destination-prefix-only rules
+  std::array<uint32_t, DSCP_COUNT> m_dscpRules;                 //!< First DSCP-only rule of each code point
+  std::vector<Tuple> m_tuples;                                  //!< Tuples sorted by lowest rule
+  std::vector<std::pair<uint32_t, const Filter*>> m_opaqueRules; //!< Rules that need Filter::Match
+  std::vector<int> m_ruleClass;                                 //!< Class index of each rule
+  int m_defaultClass;                                           //!< Class used when nothing matches
+};
+
+} // namespace ns3
+
+#endif // PACKET_CLASSIFIER_H
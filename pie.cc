@@ -0,0 +1,141 @@
+/*
+ * This program implements the Proportional Integral controller Enhanced
+ * (PIE) active queue management algorithm for a traffic class.
+ */
+
+#include "pie.h"
+#include "traffic-class.h"
+#include "ns3/simulator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+/**
+ * \brief Constructor
+ * \param target Target queueing delay
+ * \param tUpdate Period of the drop probability update
+ */
+PIE::PIE (Time target, Time tUpdate)
+  : m_target (target),
+    m_tUpdate (tUpdate),
+    m_maxBurst (MilliSeconds (150)),
+    m_alpha (0.125),
+    m_beta (1.25),
+    m_dropProb (0),
+    m_qdelayOld (Seconds (0)),
+    m_burstAllowance (MilliSeconds (150)),
+    m_nextUpdate (Seconds (0)),
+    m_uniform (CreateObject<UniformRandomVariable> ())
+{
+}
+
+/**
+ * \brief Run the PI controller
+ * \param qdelay Current queueing delay of the class
+ * \param now The current time
+ */
+void
+PIE::UpdateProbability (Time qdelay, Time now)
+{
+  // Updates missed while no packet arrived
+  uint64_t periods = 1;
+  if (now > m_nextUpdate && !m_nextUpdate.IsZero ())
+    {
+      periods += (now - m_nextUpdate).GetTimeStep () / m_tUpdate.GetTimeStep ();
+    }
+
+  // Scale the step down while the probability is small, so that light
+  // congestion is not answered with a burst of drops
+  double delta = m_alpha * (qdelay - m_target).GetSeconds ()
+                 + m_beta * (qdelay - m_qdelayOld).GetSeconds ();
+  static const double thresholds[] = {0.000001, 0.00001, 0.0001, 0.001, 0.01, 0.1};
+  static const double divisors[] = {2048, 512, 128, 32, 8, 2};
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      if (m_dropProb < thresholds[i])
+        {
+          delta /= divisors[i];
+          break;
+        }
+    }
+
+  // Cap the step at high probabilities, and react fast to a large delay
+  if (m_dropProb >= 0.1 && delta > 0.02)
+    {
+      delta = 0.02;
+    }
+  if (qdelay > MilliSeconds (250))
+    {
+      delta += 0.02;
+    }
+  m_dropProb = std::min (std::max (m_dropProb + delta, 0.0), 1.0);
+
+  // An idle queue decays the probability by 2% per period
+  if (qdelay.IsZero () && m_qdelayOld.IsZero ())
+    {
+      m_dropProb *= std::pow (0.98, static_cast<double> (periods));
+    }
+
+  // Allow a new burst once the queue has drained
+  if (m_burstAllowance > m_tUpdate * periods)
+    {
+      m_burstAllowance -= m_tUpdate * periods;
+    }
+  else
+    {
+      m_burstAllowance = Seconds (0);
+    }
+  if (m_dropProb == 0 && qdelay < m_target / 2 && m_qdelayOld < m_target / 2)
+    {
+      m_burstAllowance = m_maxBurst;
+    }
+
+  m_qdelayOld = qdelay;
+  m_nextUpdate = now + m_tUpdate;
+}
+
+/**
+ * \brief Update the drop probability if due and decide the fate of an arriving packet
+ * \param tc The traffic class the packet is about to join
+ * \param size Size of the packet in bytes
+ * \return true to drop the packet
+ */
+bool
+PIE::DropOnEnqueue (const TrafficClass& tc, uint32_t size)
+{
+  Time now = Simulator::Now ();
+  Time qdelay = tc.IsEmpty () ? Seconds (0) : now - tc.GetHeadEnqueueTime ();
+  if (now >= m_nextUpdate)
+    {
+      UpdateProbability (qdelay, now);
+    }
+
+  // Safeguards of RFC 8033: bursts, low delay with a low probability and
+  // queues of a couple of packets are never dropped from
+  if (m_burstAllowance.IsStrictlyPositive ()
+      || (m_qdelayOld < m_target / 2 && m_dropProb < 0.2)
+      || tc.GetBytes () <= 2 * MTU)
+    {
+      return false;
+    }
+
+  if (m_uniform->GetValue () < m_dropProb)
+    {
+      m_drops++;
+      return true;
+    }
+  return false;
+}
+
+/**
+ * \brief Get the current drop probability
+ * \return Probability in [0, 1]
+ */
+double
+PIE::GetDropProbability () const
+{
+  return m_dropProb;
+}
+
+} // namespace ns3
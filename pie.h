@@ -0,0 +1,75 @@
+/*
+ * This program implements the Proportional Integral controller Enhanced
+ * (PIE) active queue management algorithm for a traffic class.
+ */
+
+#ifndef PIE_H
+#define PIE_H
+
+#include "aqm.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+/**
+ * \brief Proportional Integral controller Enhanced (PIE) AQM, RFC 8033
+ *
+ * PIE drops arriving packets at random with a probability that a PI
+ * controller steers so that the queueing delay converges on the target.
+ * The delay is that of the head packet of the class, read from its
+ * enqueue timestamp (the timestamp variant of RFC 8033), so no departure
+ * rate has to be estimated. The probability is updated lazily: the
+ * first arrival after each update period runs the update, so PIE
+ * schedules no timer, and periods during which the class stayed empty
+ * decay the probability together. Bursts are let through for a short
+ * time after the queue was idle.
+ */
+class PIE : public Aqm
+{
+public:
+  /**
+   * \brief Constructor
+   * \param target Target queueing delay (default 15 ms)
+   * \param tUpdate Period of the drop probability update (default 15 ms)
+   */
+  PIE (Time target = MilliSeconds (15), Time tUpdate = MilliSeconds (15));
+
+  /**
+   * \brief Update the drop probability if due and decide the fate of an arriving packet
+   * \param tc The traffic class the packet is about to join
+   * \param size Size of the packet in bytes
+   * \return true to drop the packet
+   */
+  bool DropOnEnqueue (const TrafficClass& tc, uint32_t size) override;
+
+  /**
+   * \brief Get the current drop probability
+   * \return Probability in [0, 1]
+   */
+  double GetDropProbability () const;
+
+private:
+  static constexpr uint32_t MTU = 1500;   //!< Packet size used by the small-queue safeguard
+
+  /**
+   * \brief Run the PI controller
+   * \param qdelay Current queueing delay of the class
+   * \param now The current time
+   */
+  void UpdateProbability (Time qdelay, Time now);
+
+  Time m_target;                          //!< Target queueing delay
+  Time m_tUpdate;                         //!< Period of the drop probability update
+  Time m_maxBurst;                        //!< Burst allowance after an idle queue
+  double m_alpha;                         //!< Weight of the delay error, in 1/s
+  double m_beta;                          //!< Weight of the delay trend, in 1/s
+  double m_dropProb;                      //!< Current drop probability
+  Time m_qdelayOld;                       //!< Queueing delay at the previous update
+  Time m_burstAllowance;                  //!< Remaining time during which nothing is dropped
+  Time m_nextUpdate;                      //!< Time of the next probability update
+  Ptr<UniformRandomVariable> m_uniform;   //!< Random draws of the drop decision
+};
+
+} // namespace ns3
+
+#endif // PIE_H
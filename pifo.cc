@@ -0,0 +1,220 @@
+/*
+ * This program implements a rank-based programmable scheduler built on a
+ * push-in-first-out (PIFO) queue for Quality of Service (QoS) packet
+ * scheduling.
+ */
+
+#include "pifo.h"
+#include "ns3/simulator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - starts with no classes and a virtual time of zero
+ */
+PIFO::PIFO ()
+  : m_heads (POLICIES, BucketQueue (RANK_FRACTION_BITS)),
+    m_virtualTime (0)
+{
+}
+
+/**
+ * \brief Convert a rank function name from the configuration
+ * \param name "priority", "finish", "deadline" or "las"
+ * \param policy Set to the rank function
+ * \return true if the name is known
+ */
+bool
+PIFO::ParseRankPolicy (const std::string& name, RankPolicy& policy)
+{
+  if (name == "priority")
+    {
+      policy = RANK_PRIORITY;
+    }
+  else if (name == "finish")
+    {
+      policy = RANK_FINISH_TIME;
+    }
+  else if (name == "deadline")
+    {
+      policy = RANK_DEADLINE;
+    }
+  else if (name == "las")
+    {
+      policy = RANK_LAS;
+    }
+  else
+    {
+      return false;
+    }
+  return true;
+}
+
+/**
+ * \brief Set the rank function of a traffic class
+ * \param index Index of the traffic class
+ * \param policy Rank function used for its head packets
+ */
+void
+PIFO::SetRankPolicy (uint32_t index, RankPolicy policy)
+{
+  m_policy[index] = policy;
+}
+
+/**
+ * \brief Get the rank function of a traffic class
+ * \param index Index of the traffic class
+ * \return Rank function used for its head packets
+ */
+RankPolicy
+PIFO::GetRankPolicy (uint32_t index) const
+{
+  return m_policy[index];
+}
+
+/**
+ * \brief Set the delay budget of a class ranked by deadline
+ * \param index Index of the traffic class
+ * \param budget Time after its enqueue by which a packet should leave
+ */
+void
+PIFO::SetDeadline (uint32_t index, Time budget)
+{
+  m_deadline[index] = budget;
+}
+
+/**
+ * \brief Compute the rank of the head packet of a class
+ * \param index Index of a backlogged traffic class
+ * \return Rank of its head packet, with RANK_FRACTION_BITS fractional bits
+ *
+ * For RANK_FINISH_TIME the finish time of the class advances by the head
+ * size over the weight, starting no earlier than the finish time of the
+ * packet last served. Finish times are kept in fixed point, as in WF2Q+.
+ */
+uint64_t
+PIFO::Rank (uint32_t index)
+{
+  const TrafficClass* tc = GetClasses ()[index];
+
+  switch (m_policy[index])
+    {
+    case RANK_FINISH_TIME:
+      {
+        double weight = tc->GetWeight () > 0 ? tc->GetWeight () : 1;
+        uint64_t costPerByte = static_cast<uint64_t> (std::llround (std::ldexp (1 / weight, RANK_FRACTION_BITS)));
+        m_start[index] = std::max (m_finish[index], m_virtualTime);
+        m_finish[index] = m_start[index] + tc->GetHeadSize () * costPerByte;
+        return m_finish[index];
+      }
+    case RANK_DEADLINE:
+      {
+        int64_t deadline = (tc->GetHeadEnqueueTime () + m_deadline[index]).GetMicroSeconds ();
+        return (static_cast<uint64_t> (std::max<int64_t> (deadline, 0)) / DEADLINE_UNIT_US) << RANK_FRACTION_BITS;
+      }
+    case RANK_LAS:
+      return m_attained[index] << (RANK_FRACTION_BITS - LAS_SHIFT);
+    case RANK_PRIORITY:
+    default:
+      return static_cast<uint64_t> (tc->GetPriority ()) << RANK_FRACTION_BITS;
+    }
+}
+
+/**
+ * \brief Select the class whose head packet has the lowest rank
+ * \return The scheduled class and the packet at its front
+ *
+ * Equal ranks of different rank functions go to the function listed
+ * first in RankPolicy.
+ */
+ScheduleResult
+PIFO::Schedule () const
+{
+  uint32_t index = BucketQueue::NONE;
+  uint64_t rank = 0;
+  for (const BucketQueue& heads : m_heads)
+    {
+      uint32_t top = heads.Top ();
+      if (top != BucketQueue::NONE && (index == BucketQueue::NONE || heads.GetRank (top) < rank))
+        {
+          index = top;
+          rank = heads.GetRank (top);
+        }
+    }
+
+  if (index == BucketQueue::NONE)
+    {
+      return {-1, nullptr};
+    }
+  return {static_cast<int> (index), GetClasses ()[index]->Peek ()};
+}
+
+/**
+ * \brief Rank the head of a class that becomes backlogged
+ * \param index Index of the traffic class the packet was enqueued into
+ */
+void
+PIFO::NotifyEnqueue (uint32_t index)
+{
+  BucketQueue& heads = m_heads[m_policy[index]];
+  if (!heads.Contains (index))
+    {
+      heads.Push (index, Rank (index));
+    }
+}
+
+/**
+ * \brief Account for the served packet and rank the next head of the class
+ * \param index Index of the traffic class the packet was dequeued from
+ * \param size Size of the dequeued packet in bytes
+ *
+ * The served class always has the lowest rank of its rank function. A
+ * packet dropped by the AQM (size 0) got no service: it does not move the
+ * virtual time, and its finish time is taken back.
+ */
+void
+PIFO::NotifyDequeue (uint32_t index, uint32_t size)
+{
+  BucketQueue& heads = m_heads[m_policy[index]];
+  heads.Pop ();
+  m_attained[index] += size;
+  if (m_policy[index] == RANK_FINISH_TIME)
+    {
+      if (size == 0)
+        {
+          m_finish[index] = m_start[index];
+        }
+      else
+        {
+          m_virtualTime = m_finish[index];
+        }
+    }
+
+  if (IsReady (index))
+    {
+      heads.Push (index, Rank (index));
+    }
+}
+
+/**
+ * \brief Add a traffic class, ranked by its priority until configured otherwise
+ * \param trafficClass Pointer to the traffic class to add
+ */
+void
+PIFO::AddClass (TrafficClass* trafficClass)
+{
+  DiffServ::AddClass (trafficClass);
+  for (BucketQueue& heads : m_heads)
+    {
+      heads.Resize (GetClasses ().size ());
+    }
+  m_policy.push_back (RANK_PRIORITY);
+  m_deadline.push_back (Seconds (0));
+  m_start.push_back (0);
+  m_finish.push_back (0);
+  m_attained.push_back (0);
+}
+
+} // namespace ns3
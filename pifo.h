@@ -0,0 +1,138 @@
+/*
+ * This program implements a rank-based programmable scheduler built on a
+ * push-in-first-out (PIFO) queue for Quality of Service (QoS) packet
+ * scheduling.
+ */
+
+#ifndef PIFO_H
+#define PIFO_H
+
+#include "diff-serve.h"
+#include "bucket-queue.h"
+#include "ns3/nstime.h"
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Rank functions a traffic class can use in a PIFO scheduler
+ *
+ * Lower ranks are served first. Ranks of different classes are compared
+ * directly, so classes using different functions can be mixed, e.g. a
+ * priority-0 class ahead of a set of fair-queued classes. Ranks carry
+ * PIFO::RANK_FRACTION_BITS fractional bits, so finish times keep their
+ * fraction of a byte.
+ */
+enum RankPolicy
+{
+  RANK_PRIORITY = 0,       //!< The class priority, as in SPQ
+  RANK_FINISH_TIME,        //!< Virtual finish time in bytes over weight (self-clocked fair queuing)
+  RANK_DEADLINE,           //!< Enqueue time plus the class delay budget, in units of 100 us
+  RANK_LAS                 //!< Bytes served so far in KiB (least attained service)
+};
+
+/**
+ * \ingroup diffserv
+ * \brief Programmable scheduler extending DiffServ
+ *
+ * Every class supplies a rank function, chosen with SetRankPolicy, that
+ * is evaluated for its head packet whenever the class gets a new head.
+ * The heads of the backlogged classes are kept in BucketQueues, the
+ * Eiffel-style bucketed integer priority queue, one per rank function:
+ * priorities, finish times, deadlines and attained service grow at
+ * unrelated paces, and each queue's window follows the ranks of one
+ * function only. Inserting a head and extracting the lowest rank of a
+ * function are O(1) for ranks that fit the window, and Schedule compares
+ * the lowest rank of each function. New policies only need a new rank
+ * function instead of another Schedule loop.
+ */
+class PIFO : public DiffServ
+{
+public:
+  static constexpr uint32_t RANK_FRACTION_BITS = 16;  //!< Fractional bits of ranks
+
+  /**
+   * \brief Constructor
+   */
+  PIFO ();
+
+  /**
+   * \brief Select the class whose head packet has the lowest rank
+   * \return The scheduled class and the packet at its front
+   */
+  ScheduleResult Schedule () const override;
+
+  /**
+   * \brief Add a traffic class, ranked by its priority until configured otherwise
+   * \param trafficClass Pointer to the traffic class to add
+   */
+  void AddClass (TrafficClass* trafficClass) override;
+
+  /**
+   * \brief Set the rank function of a traffic class
+   * \param index Index of the traffic class
+   * \param policy Rank function used for its head packets
+   */
+  void SetRankPolicy (uint32_t index, RankPolicy policy);
+
+  /**
+   * \brief Get the rank function of a traffic class
+   * \param index Index of the traffic class
+   * \return Rank function used for its head packets
+   */
+  RankPolicy GetRankPolicy (uint32_t index) const;
+
+  /**
+   * \brief Set the delay budget of a class ranked by deadline
+   * \param index Index of the traffic class
+   * \param budget Time after its enqueue by which a packet should leave
+   */
+  void SetDeadline (uint32_t index, Time budget);
+
+  /**
+   * \brief Convert a rank function name from the configuration
+   * \param name "priority", "finish", "deadline" or "las"
+   * \param policy Set to the rank function
+   * \return true if the name is known
+   */
+  static bool ParseRankPolicy (const std::string& name, RankPolicy& policy);
+
+protected:
+  /**
+   * \brief Rank the head of a class that becomes backlogged
+   * \param index Index of the traffic class the packet was enqueued into
+   */
+  void NotifyEnqueue (uint32_t index) override;
+
+  /**
+   * \brief Account for the served packet and rank the next head of the class
+   * \param index Index of the traffic class the packet was dequeued from
+   * \param size Size of the dequeued packet in bytes
+   */
+  void NotifyDequeue (uint32_t index, uint32_t size) override;
+
+private:
+  /**
+   * \brief Compute the rank of the head packet of a class
+   * \param index Index of a backlogged traffic class
+   * \return Rank of its head packet, with RANK_FRACTION_BITS fractional bits
+   */
+  uint64_t Rank (uint32_t index);
+
+  static constexpr int64_t DEADLINE_UNIT_US = 100;  //!< Deadline rank unit in microseconds
+  static constexpr uint32_t LAS_SHIFT = 10;         //!< Attained service rank unit (bytes, log2)
+  static constexpr uint32_t POLICIES = RANK_LAS + 1; //!< Number of rank functions
+
+  std::vector<BucketQueue> m_heads;        //!< Backlogged classes by head rank, per rank function
+  std::vector<RankPolicy> m_policy;        //!< Rank function of each class
+  std::vector<Time> m_deadline;            //!< Delay budget of each class
+  std::vector<uint64_t> m_start;           //!< Virtual start time of each head packet
+  std::vector<uint64_t> m_finish;          //!< Virtual finish time of each class
+  std::vector<uint64_t> m_attained;        //!< Bytes served from each class
+  uint64_t m_virtualTime;                  //!< Finish time of the last served packet
+};
+
+} // namespace ns3
+
+#endif // PIFO_H
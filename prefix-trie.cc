@@ -0,0 +1,194 @@
+/*
+ * This program implements a path-compressed binary trie of IPv4 prefixes
+ * used by the packet classifier.
+ */
+
+#include "prefix-trie.h"
+#include <algorithm>
+
+namespace ns3 {
+
+namespace {
+
+/**
+ * \brief Get the mask of a prefix length
+ * \param length Prefix length in bits
+ * \return Mask with the upper length bits set
+ */
+uint32_t
+PrefixMask (uint8_t length)
+{
+  return length == 0 ? 0 : 0xffffffffu << (32 - length);
+}
+
+/**
+ * \brief Get a bit of an address
+ * \param address Address in host byte order
+ * \param position Bit position, 0 being the most significant bit
+ * \return The bit
+ */
+uint32_t
+BitAt (uint32_t address, uint8_t position)
+{
+  return (address >> (31 - position)) & 1;
+}
+
+} // namespace
+
+/**
+ * \brief Constructor - creates an empty trie
+ */
+PrefixTrie::PrefixTrie ()
+  : m_root (NONE)
+{
+}
+
+/**
+ * \brief Remove every prefix
+ */
+void
+PrefixTrie::Clear ()
+{
+  m_nodes.clear ();
+  m_root = NONE;
+}
+
+/**
+ * \brief Append a node
+ * \param prefix Prefix bits
+ * \param length Prefix length in bits
+ * \param value Value of the prefix, or NONE
+ * \return Index of the new node
+ */
+uint32_t
+PrefixTrie::NewNode (uint32_t prefix, uint8_t length, uint32_t value)
+{
+  m_nodes.push_back ({prefix & PrefixMask (length), length, value, {NONE, NONE}});
+  return m_nodes.size () - 1;
+}
+
+/**
+ * \brief Add a prefix
+ * \param prefix Network address in host byte order
+ * \param length Prefix length in bits (0 to 32)
+ * \param value Value of the prefix; the smallest value is kept if the
+ *        prefix is added more than once
+ */
+void
+PrefixTrie::Insert (uint32_t prefix, uint8_t length, uint32_t value)
+{
+  length = std::min<uint8_t> (length, 32);
+  prefix &= PrefixMask (length);
+
+  if (m_root == NONE)
+    {
+      m_root = NewNode (prefix, length, value);
+      return;
+    }
+
+  // Walk down, remembering which link points at the current node
+  uint32_t parent = NONE;
+  uint32_t parentBit = 0;
+  uint32_t index = m_root;
+  while (true)
+    {
+      Node node = m_nodes[index];
+      uint32_t diff = prefix ^ node.prefix;
+      uint8_t common = diff == 0 ? 32 : __builtin_clz (diff);
+      common = std::min ({common, length, node.length});
+
+      if (common < node.length)
+        {
+          // The new prefix diverges inside this node: split it
+          uint32_t split = NewNode (prefix, common, NONE);
+          m_nodes[split].child[BitAt (node.prefix, common)] = index;
+          if (common == length)
+            {
+              m_nodes[split].value = value;
+            }
+          else
+            {
+              uint32_t leaf = NewNode (prefix, length, value);
+              m_nodes[split].child[BitAt (prefix, common)] = leaf;
+            }
+
+          if (parent == NONE)
+            {
+              m_root = split;
+            }
+          else
+            {
+              m_nodes[parent].child[parentBit] = split;
+            }
+          return;
+        }
+
+      if (length == node.length)
+        {
+          // Same prefix: keep the smallest value
+          m_nodes[index].value = std::min (node.value, value);
+          return;
+        }
+
+      // This node is a prefix of the new one: descend
+      uint32_t bit = BitAt (prefix, node.length);
+      if (node.child[bit] == NONE)
+        {
+          uint32_t leaf = NewNode (prefix, length, value);
+          m_nodes[index].child[bit] = leaf;
+          return;
+        }
+      parent = index;
+      parentBit = bit;
+      index = node.child[bit];
+    }
+}
+
+/**
+ * \brief Find the smallest value among all prefixes containing an address
+ * \param address Address in host byte order
+ * \return The smallest value, or NONE if no prefix contains the address
+ */
+uint32_t
+PrefixTrie::Lookup (uint32_t address) const
+{
+  uint32_t best = NONE;
+  uint32_t index = m_root;
+  while (index != NONE)
+    {
+      const Node& node = m_nodes[index];
+      if ((address & PrefixMask (node.length)) != node.prefix)
+        {
+          break;
+        }
+      best = std::min (best, node.value);
+      if (node.length == 32)
+        {
+          break;
+        }
+      index = node.child[BitAt (address, node.length)];
+    }
+  return best;
+}
+
+/**
+ * \brief Check whether the trie holds no prefix
+ * \return true if the trie is empty
+ */
+bool
+PrefixTrie::IsEmpty () const
+{
+  return m_root == NONE;
+}
+
+/**
+ * \brief Get the number of trie nodes
+ * \return Number of nodes
+ */
+uint32_t
+PrefixTrie::GetNodeCount () const
+{
+  return m_nodes.size ();
+}
+
+} // namespace ns3
@@ -0,0 +1,94 @@
+/*
+ * This program implements a path-compressed binary trie of IPv4 prefixes
+ * used by the packet classifier.
+ */
+
+#ifndef PREFIX_TRIE_H
+#define PREFIX_TRIE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Path-compressed binary (Patricia) trie of IPv4 prefixes
+ *
+ * Each prefix carries a value, and a lookup returns the smallest value
+ * among all prefixes containing the address. With rule numbers as values
+ * this is the first matching rule, which is what DiffServ classification
+ * needs (rather than the longest match). Chains of single-child nodes are
+ * collapsed, so a lookup visits at most 33 nodes whatever the number of
+ * prefixes. Nodes are stored contiguously in a vector.
+ */
+class PrefixTrie
+{
+public:
+  static constexpr uint32_t NONE = 0xffffffff; //!< No value / no node
+
+  /**
+   * \brief Constructor - creates an empty trie
+   */
+  PrefixTrie ();
+
+  /**
+   * \brief Remove every prefix
+   */
+  void Clear ();
+
+  /**
+   * \brief Add a prefix
+   * \param prefix Network address in host byte order
+   * \param length Prefix length in bits (0 to 32)
+   * \param value Value of the prefix; the smallest value is kept if the
+   *        prefix is added more than once
+   */
+  void Insert (uint32_t prefix, uint8_t length, uint32_t value);
+
+  /**
+   * \brief Find the smallest value among all prefixes containing an address
+   * \param address Address in host byte order
+   * \return The smallest value, or NONE if no prefix contains the address
+   */
+  uint32_t Lookup (uint32_t address) const;
+
+  /**
+   * \brief Check whether the trie holds no prefix
+   * \return true if the trie is empty
+   */
+  bool IsEmpty () const;
+
+  /**
+   * \brief Get the number of trie nodes
+   * \return Number of nodes
+   */
+  uint32_t GetNodeCount () const;
+
+private:
+  /**
+   * \brief A trie node covering the prefix bits skipped since its parent
+   */
+  struct Node
+  {
+    uint32_t prefix;       //!< Prefix bits, masked to length
+    uint8_t length;        //!< Prefix length in bits
+    uint32_t value;        //!< Value of this exact prefix, or NONE
+    uint32_t child[2];     //!< Children by the bit following the prefix
+  };
+
+  /**
+   * \brief Append a node
+   * \param prefix Prefix bits
+   * \param length Prefix length in bits
+   * \param value Value of the prefix, or NONE
+   * \return Index of the new node
+   */
+  uint32_t NewNode (uint32_t prefix, uint8_t length, uint32_t value);
+
+  std::vector<Node> m_nodes; //!< Node storage
+  uint32_t m_root;           //!< Index of the root node, or NONE
+};
+
+} // namespace ns3
+
+#endif // PREFIX_TRIE_H
@@ -0,0 +1,120 @@
+/*
+ * This program implements a two-level bitmap of priority levels with
+ * constant-time lookup of the lowest set level.
+ */
+
+#include "priority-bitmap.h"
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates an empty bitmap
+ */
+PriorityBitmap::PriorityBitmap ()
+{
+  Reset ();
+}
+
+/**
+ * \brief Mark a level as set
+ * \param level Level to set, below MAX_LEVELS
+ */
+void
+PriorityBitmap::Set (uint32_t level)
+{
+  m_words[level >> 6] |= uint64_t (1) << (level & 63);
+  m_summary |= uint64_t (1) << (level >> 6);
+}
+
+/**
+ * \brief Mark a level as clear
+ * \param level Level to clear, below MAX_LEVELS
+ */
+void
+PriorityBitmap::Clear (uint32_t level)
+{
+  m_words[level >> 6] &= ~(uint64_t (1) << (level & 63));
+  if (m_words[level >> 6] == 0)
+    {
+      m_summary &= ~(uint64_t (1) << (level >> 6));
+    }
+}
+
+/**
+ * \brief Clear every level
+ */
+void
+PriorityBitmap::Reset ()
+{
+  m_summary = 0;
+  for (auto& word : m_words)
+    {
+      word = 0;
+    }
+}
+
+/**
+ * \brief Check whether a level is set
+ * \param level Level to check
+ * \return true if the level is set
+ */
+bool
+PriorityBitmap::IsSet (uint32_t level) const
+{
+  return (m_words[level >> 6] >> (level & 63)) & 1;
+}
+
+/**
+ * \brief Check whether no level is set
+ * \return true if the bitmap is empty
+ */
+bool
+PriorityBitmap::IsEmpty () const
+{
+  return m_summary == 0;
+}
+
+/**
+ * \brief Find the lowest set level
+ * \return The lowest set level, or -1 if the bitmap is empty
+ */
+int
+PriorityBitmap::FindFirstSet () const
+{
+  if (m_summary == 0)
+    {
+      return -1;
+    }
+
+  // First non-zero word, then the lowest bit inside it
+  int word = __builtin_ctzll (m_summary);
+  return (word << 6) + __builtin_ctzll (m_words[word]);
+}
+
+/**
+ * \brief Find the lowest set level at or above a given level
+ * \param level Level to start from, below MAX_LEVELS
+ * \return The lowest set level not below level, or -1 if there is none
+ */
+int
+PriorityBitmap::FindNextSet (uint32_t level) const
+{
+  // Remaining bits of the word holding the level
+  uint32_t word = level >> 6;
+  uint64_t bits = m_words[word] & (~uint64_t (0) << (level & 63));
+  if (bits != 0)
+    {
+      return (word << 6) + __builtin_ctzll (bits);
+    }
+
+  // Otherwise the first non-zero word after it
+  uint64_t summary = word < 63 ? m_summary & (~uint64_t (0) << (word + 1)) : 0;
+  if (summary == 0)
+    {
+      return -1;
+    }
+  word = __builtin_ctzll (summary);
+  return (word << 6) + __builtin_ctzll (m_words[word]);
+}
+
+} // namespace ns3
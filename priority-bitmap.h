@@ -0,0 +1,81 @@
+/*
+ * This program implements a two-level bitmap of priority levels with
+ * constant-time lookup of the lowest set level.
+ */
+
+#ifndef PRIORITY_BITMAP_H
+#define PRIORITY_BITMAP_H
+
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * \brief Two-level bitmap over up to 4096 priority levels
+ *
+ * Each bit marks a level as backlogged. A summary word records which of
+ * the 64 leaf words are non-zero, so the lowest set level is found with
+ * two count-trailing-zeros instructions regardless of how many levels
+ * are in use.
+ */
+class PriorityBitmap
+{
+public:
+  static constexpr uint32_t MAX_LEVELS = 64 * 64; //!< Number of levels supported
+
+  /**
+   * \brief Constructor - creates an empty bitmap
+   */
+  PriorityBitmap ();
+
+  /**
+   * \brief Mark a level as set
+   * \param level Level to set, below MAX_LEVELS
+   */
+  void Set (uint32_t level);
+
+  /**
+   * \brief Mark a level as clear
+   * \param level Level to clear, below MAX_LEVELS
+   */
+  void Clear (uint32_t level);
+
+  /**
+   * \brief Clear every level
+   */
+  void Reset ();
+
+  /**
+   * \brief Check whether a level is set
+   * \param level Level to check
+   * \return true if the level is set
+   */
+  bool IsSet (uint32_t level) const;
+
+  /**
+   * \brief Check whether no level is set
+   * \return true if the bitmap is empty
+   */
+  bool IsEmpty () const;
+
+  /**
+   * \brief Find the lowest set level
+   * \return The lowest set level, or -1 if the bitmap is empty
+   */
+  int FindFirstSet () const;
+
+  /**
+   * \brief Find the lowest set level at or above a given level
+   * \param level Level to start from, below MAX_LEVELS
+   * \return The lowest set level not below level, or -1 if there is none
+   */
+  int FindNextSet (uint32_t level) const;
+
+private:
+  uint64_t m_summary;    //!< Bit i is set when m_words[i] is non-zero
+  uint64_t m_words[64];  //!< One bit per level
+};
+
+} // namespace ns3
+
+#endif // PRIORITY_BITMAP_H
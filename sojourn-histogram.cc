@@ -0,0 +1,146 @@
+/*
+ * This program implements a constant-memory log-linear histogram of
+ * packet sojourn times.
+ */
+
+#include "sojourn-histogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates an empty histogram
+ */
+SojournHistogram::SojournHistogram ()
+  : m_counts (BUCKETS, 0),
+    m_count (0),
+    m_max (0)
+{
+}
+
+/**
+ * \brief Get the bucket holding a value
+ * \param value Value in nanoseconds
+ * \return Bucket index
+ *
+ * Values below SUB_BUCKETS map to themselves. A larger value whose most
+ * significant bit is msb falls in group (msb - SUB_BUCKET_BITS + 1), at
+ * the sub-bucket given by the SUB_BUCKET_BITS bits below the msb.
+ */
+uint32_t
+SojournHistogram::GetBucket (uint64_t value)
+{
+  if (value < SUB_BUCKETS)
+    {
+      return static_cast<uint32_t> (value);
+    }
+
+  uint32_t msb = 63 - __builtin_clzll (value);
+  if (msb >= MAX_VALUE_BITS)
+    {
+      return BUCKETS - 1;
+    }
+
+  uint32_t group = msb - SUB_BUCKET_BITS + 1;
+  uint32_t subBucket = static_cast<uint32_t> (value >> (msb - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+  return group * SUB_BUCKETS + subBucket;
+}
+
+/**
+ * \brief Get the highest value held by a bucket
+ * \param bucket Bucket index
+ * \return Highest value in nanoseconds
+ */
+uint64_t
+SojournHistogram::GetBucketHighest (uint32_t bucket)
+{
+  uint32_t group = bucket / SUB_BUCKETS;
+  uint64_t subBucket = bucket % SUB_BUCKETS;
+  if (group == 0)
+    {
+      return subBucket;
+    }
+
+  uint32_t shift = group - 1;
+  return ((SUB_BUCKETS + subBucket + 1) << shift) - 1;
+}
+
+/**
+ * \brief Record one sojourn time
+ * \param sojourn Time the packet spent in the queue
+ */
+void
+SojournHistogram::Record (Time sojourn)
+{
+  uint64_t value = static_cast<uint64_t> (std::max<int64_t> (sojourn.GetNanoSeconds (), 0));
+  m_counts[GetBucket (value)]++;
+  m_count++;
+  m_max = std::max (m_max, value);
+}
+
+/**
+ * \brief Clear all recorded values
+ */
+void
+SojournHistogram::Reset ()
+{
+  std::fill (m_counts.begin (), m_counts.end (), 0);
+  m_count = 0;
+  m_max = 0;
+}
+
+/**
+ * \brief Get the number of recorded values
+ * \return Number of recorded values
+ */
+uint64_t
+SojournHistogram::GetCount () const
+{
+  return m_count;
+}
+
+/**
+ * \brief Get a percentile of the recorded values
+ * \param percentile Percentile in [0, 100], e.g. 99.9
+ * \return The highest value equivalent to the percentile, or zero if
+ *         nothing was recorded
+ */
+Time
+SojournHistogram::GetPercentile (double percentile) const
+{
+  if (m_count == 0)
+    {
+      return NanoSeconds (0);
+    }
+
+  // Rank of the requested value, at least the first one
+  double fraction = std::min (std::max (percentile, 0.0), 100.0) / 100.0;
+  uint64_t rank = std::max<uint64_t> (1, static_cast<uint64_t> (std::ceil (fraction * m_count)));
+
+  uint64_t seen = 0;
+  for (uint32_t bucket = 0; bucket < BUCKETS; bucket++)
+    {
+      seen += m_counts[bucket];
+      if (seen >= rank)
+        {
+          // The last bucket also holds every out-of-range value
+          uint64_t highest = bucket == BUCKETS - 1 ? m_max : GetBucketHighest (bucket);
+          return NanoSeconds (std::min (highest, m_max));
+        }
+    }
+
+  return NanoSeconds (m_max);
+}
+
+/**
+ * \brief Get the largest recorded value
+ * \return The exact largest recorded value
+ */
+Time
+SojournHistogram::GetMax () const
+{
+  return NanoSeconds (m_max);
+}
+
+} // namespace ns3
@@ -0,0 +1,91 @@
+/*
+ * This program implements a constant-memory log-linear histogram of
+ * packet sojourn times.
+ */
+
+#ifndef SOJOURN_HISTOGRAM_H
+#define SOJOURN_HISTOGRAM_H
+
+#include "ns3/nstime.h"
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Log-linear histogram of sojourn times, in the style of HdrHistogram
+ *
+ * Values are recorded in nanoseconds. Values below 128 ns get one bucket
+ * each; above that, every power of two is split into 128 linear
+ * sub-buckets, which bounds the relative error of a reported percentile
+ * to under 1%. The bucket array is allocated once and covers values up
+ * to 2^44 ns (about 4.9 hours), so memory use does not depend on how
+ * many packets are recorded.
+ */
+class SojournHistogram
+{
+public:
+  /**
+   * \brief Constructor - creates an empty histogram
+   */
+  SojournHistogram ();
+
+  /**
+   * \brief Record one sojourn time
+   * \param sojourn Time the packet spent in the queue
+   */
+  void Record (Time sojourn);
+
+  /**
+   * \brief Clear all recorded values
+   */
+  void Reset ();
+
+  /**
+   * \brief Get the number of recorded values
+   * \return Number of recorded values
+   */
+  uint64_t GetCount () const;
+
+  /**
+   * \brief Get a percentile of the recorded values
+   * \param percentile Percentile in [0, 100], e.g. 99.9
+   * \return The highest value equivalent to the percentile, or zero if
+   *         nothing was recorded
+   */
+  Time GetPercentile (double percentile) const;
+
+  /**
+   * \brief Get the largest recorded value
+   * \return The exact largest recorded value
+   */
+  Time GetMax () const;
+
+private:
+  static constexpr uint32_t SUB_BUCKET_BITS = 7;                      //!< log2 of the sub-buckets per power of two
+  static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;      //!< Linear sub-buckets per power of two
+  static constexpr uint32_t MAX_VALUE_BITS = 44;                      //!< Values up to 2^44 ns are resolved
+  static constexpr uint32_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS; //!< Total buckets
+
+  /**
+   * \brief Get the bucket holding a value
+   * \param value Value in nanoseconds
+   * \return Bucket index
+   */
+  static uint32_t GetBucket (uint64_t value);
+
+  /**
+   * \brief Get the highest value held by a bucket
+   * \param bucket Bucket index
+   * \return Highest value in nanoseconds
+   */
+  static uint64_t GetBucketHighest (uint32_t bucket);
+
+  std::vector<uint64_t> m_counts;  //!< Count of values per bucket
+  uint64_t m_count;                //!< Number of recorded values
+  uint64_t m_max;                  //!< Largest recorded value in nanoseconds
+};
+
+} // namespace ns3
+
+#endif // SOJOURN_HISTOGRAM_H
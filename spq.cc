@@ -5,7 +5,8 @@
  */
 
 #include "spq.h"
-#include <iostream>
+#include "ns3/abort.h"
+#include <algorithm>
 #include <limits>
 
 namespace ns3 {
@@ -19,51 +20,102 @@ SPQ::SPQ ()
 }
 
 /**
- * \brief Select the next packet to be dequeued based on SPQ algorithm
- * \return Packet at the front of the highest priority non-empty queue
+ * \brief Add a traffic class and recompute the priority levels
+ * \param trafficClass Pointer to the traffic class to add
  *
- * This method implements the core SPQ scheduling algorithm, which
- * always selects packets from the highest priority queue that has packets.
+ * Classes are ranked by priority value, ties broken by insertion order,
+ * and the backlog bitmap is rebuilt for the new ranking.
  */
-Ptr<const Packet> 
-SPQ::Schedule () const
+void
+SPQ::AddClass (TrafficClass* trafficClass)
 {
-  // Get all traffic classes
-  std::vector<TrafficClass*> classes = GetClasses ();
-  
-  // If no classes, return nullptr
-  if (classes.empty ()) 
+  NS_ABORT_MSG_IF (GetClasses ().size () >= PriorityBitmap::MAX_LEVELS,
+                   "SPQ supports at most " << PriorityBitmap::MAX_LEVELS << " classes");
+
+  DiffServ::AddClass (trafficClass);
+  const std::vector<TrafficClass*>& classes = GetClasses ();
+
+  m_classAt.resize (classes.size ());
+  for (uint32_t i = 0; i < classes.size (); i++)
     {
-      return nullptr;
+      m_classAt[i] = i;
     }
-  
-  // Find the highest priority class (lowest priority value) that has packets
-  TrafficClass* highestPriorityClass = nullptr;
-  uint32_t highestPriority = std::numeric_limits<uint32_t>::max ();
-  
-  for (size_t i = 0; i < classes.size (); ++i) 
+  std::stable_sort (m_classAt.begin (), m_classAt.end (), [&classes] (uint32_t a, uint32_t b) {
+    return classes[a]->GetPriority () < classes[b]->GetPriority ();
+  });
+
+  m_levelOf.resize (classes.size ());
+  m_backlog.Reset ();
+  for (uint32_t level = 0; level < m_classAt.size (); level++)
     {
-      auto tc = classes[i];
-      bool isEmpty = tc->IsEmpty ();
-      uint32_t priority = tc->GetPriority ();
-      
-      // If this class has packets and higher priority (lower value) than current best
-      if (!isEmpty && priority < highestPriority) 
+      m_levelOf[m_classAt[level]] = level;
+      if (IsReady (m_classAt[level]))
         {
-          highestPriorityClass = tc;
-          highestPriority = priority;
+          m_backlog.Set (level);
         }
     }
-  
-  // If we found a non-empty class, return its packet
-  if (highestPriorityClass != nullptr) 
+}
+
+/**
+ * \brief Mark the level of a class as backlogged
+ * \param index Index of the traffic class the packet was enqueued into
+ */
+void
+SPQ::NotifyEnqueue (uint32_t index)
+{
+  m_backlog.Set (m_levelOf[index]);
+}
+
+/**
+ * \brief Clear the level of a class once it is empty
+ * \param index Index of the traffic class the packet was dequeued from
+ * \param size Size of the dequeued packet in bytes
+ */
+void
+SPQ::NotifyDequeue (uint32_t index, uint32_t size)
+{
+  if (!IsReady (index))
     {
-      return highestPriorityClass->Peek ();
+      m_backlog.Clear (m_levelOf[index]);
     }
-  
+}
+
+/**
+ * \brief Let the selected class drain in one batch
+ * \param index Index of the traffic class Schedule just selected
+ * \return No byte limit
+ *
+ * No class is added to the bitmap during a dequeue, so the selected class
+ * stays the highest backlogged one for as long as it is ready.
+ */
+uint32_t
+SPQ::GetBurstBudget (uint32_t index) const
+{
+  return std::numeric_limits<uint32_t>::max ();
+}
+
+/**
+ * \brief Select the next packet to be dequeued based on SPQ algorithm
+ * \return The highest priority non-empty class and its head packet
+ *
+ * This method implements the core SPQ scheduling algorithm, which
+ * always selects packets from the highest priority queue that has packets.
+ * The lowest backlogged level is read from the bitmap in constant time.
+ */
+ScheduleResult 
+SPQ::Schedule () const
+{
+  int level = m_backlog.FindFirstSet ();
+
   // No packets in any class
-  // std::cout << "  No non-empty classes found" << std::endl;
-  return nullptr;
+  if (level < 0)
+    {
+      return {-1, nullptr};
+    }
+
+  // Return the highest priority non-empty class with its packet
+  uint32_t index = m_classAt[level];
+  return {static_cast<int> (index), GetClasses ()[index]->Peek ()};
 }
 
-} // namespace ns3
\ No newline at end of file
+} // namespace ns3
@@ -7,6 +7,8 @@
 #define SPQ_H
 
 #include "diff-serve.h"
+#include "priority-bitmap.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -18,6 +20,11 @@ namespace ns3 {
  * serves packets from the highest priority queue that has packets.
  * Lower priority queues are only served when all higher priority
  * queues are empty.
+ *
+ * Each class is given a level in (priority, index) order and a bitmap
+ * tracks which levels are backlogged, so the next class is found with a
+ * find-first-set lookup instead of a scan. Up to
+ * PriorityBitmap::MAX_LEVELS classes are supported.
  */
 class SPQ : public DiffServ 
 {
@@ -34,14 +41,46 @@ public:
   
   /**
    * \brief Select the next packet to be dequeued based on SPQ algorithm
-   * \return Packet at the front of the highest priority non-empty queue
+   * \return The highest priority non-empty class and its head packet
    *
    * This method implements the core SPQ scheduling algorithm, which
    * always selects packets from the highest priority queue that has packets.
    */
-  virtual Ptr<const Packet> Schedule () const override;
+  virtual ScheduleResult Schedule () const override;
+
+  /**
+   * \brief Add a traffic class and recompute the priority levels
+   * \param trafficClass Pointer to the traffic class to add
+   */
+  virtual void AddClass (TrafficClass* trafficClass) override;
+
+protected:
+  /**
+   * \brief Mark the level of a class as backlogged
+   * \param index Index of the traffic class the packet was enqueued into
+   */
+  virtual void NotifyEnqueue (uint32_t index) override;
+
+  /**
+   * \brief Clear the level of a class once it is empty
+   * \param index Index of the traffic class the packet was dequeued from
+   * \param size Size of the dequeued packet in bytes
+   */
+  virtual void NotifyDequeue (uint32_t index, uint32_t size) override;
+
+  /**
+   * \brief Let the selected class drain in one batch
+   * \param index Index of the traffic class Schedule just selected
+   * \return No byte limit
+   */
+  virtual uint32_t GetBurstBudget (uint32_t index) const override;
+
+private:
+  PriorityBitmap m_backlog;          //!< Backlogged levels
+  std::vector<uint32_t> m_levelOf;   //!< Level of each class
+  std::vector<uint32_t> m_classAt;   //!< Class at each level
 };
 
 } // namespace ns3
 
-#endif // SPQ_H
\ No newline at end of file
+#endif // SPQ_H
@@ -0,0 +1,162 @@
+/*
+ * This program tests the bucketed priority queue used by the PIFO
+ * scheduler. It does not depend on ns-3 and is built on its own, see the
+ * Testing section of the README.
+ */
+
+#include "bucket-queue.h"
+#include <cstdio>
+#include <random>
+#include <set>
+#include <tuple>
+
+using namespace ns3;
+
+namespace {
+
+int g_failures = 0;  //!< Number of failed checks
+
+/**
+ * \brief Record a failed check
+ * \param ok Result of the check
+ * \param what Description of the check
+ */
+void
+Check (bool ok, const char* what)
+{
+  if (!ok)
+    {
+      std::printf ("FAIL: %s\n", what);
+      g_failures++;
+    }
+}
+
+/**
+ * \brief Priority order holds after a lower priority class was served alone
+ *
+ * Serving class 1 alone moves the window to rank 1; class 0 must still go
+ * ahead of it afterwards, and keep doing so as both are served and pushed
+ * back at their own ranks.
+ */
+void
+TestPriorityAfterIdle ()
+{
+  BucketQueue queue;
+  queue.Resize (2);
+  queue.Push (1, 1);
+  Check (queue.Pop () == 1, "class 1 served alone");
+
+  queue.Push (1, 1);
+  queue.Push (0, 0);
+  for (int i = 0; i < 4; i++)
+    {
+      Check (queue.Pop () == 0, "class 0 served first");
+      queue.Push (0, 0);
+    }
+  queue.Pop ();
+  Check (queue.Pop () == 1, "class 1 served once class 0 is empty");
+  Check (queue.IsEmpty (), "queue empty");
+}
+
+/**
+ * \brief Ranks far apart keep their order
+ *
+ * Small ranks such as priorities mixed with large ones such as deadlines
+ * do not fit one window, and neither do ranks below a window that holds
+ * a rank too far above them.
+ */
+void
+TestSpreadRanks ()
+{
+  BucketQueue queue;
+  queue.Resize (3);
+  queue.Push (0, 400000);
+  queue.Push (1, 2);
+  queue.Push (2, 400000 + BucketQueue::BUCKETS);
+  Check (queue.Pop () == 1, "rank 2 first");
+  Check (queue.Pop () == 0, "rank 400000 second");
+  queue.Push (1, 5);
+  Check (queue.Pop () == 1, "rank 5 below the window");
+  Check (queue.Pop () == 2, "rank beyond the window last");
+}
+
+/**
+ * \brief Ranks sharing a bucket leave in rank order
+ */
+void
+TestFractionBits ()
+{
+  BucketQueue queue (16);
+  queue.Resize (3);
+  queue.Push (0, (7 << 16) + 900);
+  queue.Push (1, (7 << 16) + 300);
+  queue.Push (2, (7 << 16) + 600);
+  Check (queue.Pop () == 1, "lowest fraction first");
+  Check (queue.Pop () == 2, "middle fraction second");
+  Check (queue.Pop () == 0, "highest fraction last");
+}
+
+/**
+ * \brief Random pushes and pops match an ordered set
+ *
+ * Ranks are drawn around the last extracted rank, both below and above
+ * it and over more than a window, and occasionally far away.
+ */
+void
+TestRandom ()
+{
+  const uint32_t n = 300;
+  std::mt19937 rng (1);
+  BucketQueue queue;
+  queue.Resize (n);
+  std::set<std::tuple<uint64_t, uint32_t>> expected;
+  std::vector<bool> queued (n, false);
+  uint64_t last = 1000000;
+  bool ok = true;
+
+  for (int i = 0; i < 200000 && ok; i++)
+    {
+      uint32_t id = rng () % n;
+      if (rng () % 2 == 0 && !queued[id])
+        {
+          uint64_t rank = (last > 2000 ? last - 2000 : 0) + rng () % 8000;
+          if (rng () % 100 == 0)
+            {
+              rank = rng () % 2 == 0 ? rng () % 1000 : last + 100000;
+            }
+          queue.Push (id, rank);
+          expected.insert ({rank, id});
+          queued[id] = true;
+        }
+      else if (!expected.empty ())
+        {
+          // Equal ranks may leave in either order; compare the ranks
+          uint64_t rank = std::get<0> (*expected.begin ());
+          uint32_t top = queue.Top ();
+          ok = top != BucketQueue::NONE && queue.GetRank (top) == rank && queue.Pop () == top;
+          expected.erase ({rank, top});
+          queued[top] = false;
+          last = rank;
+        }
+    }
+  Check (ok, "random ranks extracted in order");
+}
+
+} // namespace
+
+int
+main ()
+{
+  TestPriorityAfterIdle ();
+  TestSpreadRanks ();
+  TestFractionBits ();
+  TestRandom ();
+
+  if (g_failures > 0)
+    {
+      std::printf ("%d check(s) failed\n", g_failures);
+      return 1;
+    }
+  std::printf ("All BucketQueue checks passed\n");
+  return 0;
+}
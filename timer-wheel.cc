@@ -0,0 +1,154 @@
+/*
+ * This program implements a hierarchical timing wheel of identifiers.
+ */
+
+#include "timer-wheel.h"
+#include <algorithm>
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - creates an empty wheel at tick 0 with no identifiers
+ */
+TimerWheel::TimerWheel ()
+  : m_slotHead (LEVELS * SLOTS, NONE),
+    m_current (0),
+    m_count (0)
+{
+}
+
+/**
+ * \brief Grow the range of identifiers, keeping the scheduled ones
+ * \param n Identifiers range from 0 to n - 1
+ */
+void
+TimerWheel::Resize (uint32_t n)
+{
+  m_next.resize (n, NONE);
+  m_tick.resize (n, 0);
+  m_scheduled.resize (n, false);
+}
+
+/**
+ * \brief Move an empty wheel to a tick
+ * \param tick The new current tick
+ */
+void
+TimerWheel::Reset (uint64_t tick)
+{
+  m_current = tick;
+}
+
+/**
+ * \brief Schedule an identifier
+ * \param id Identifier, not already scheduled
+ * \param tick Tick at which the identifier expires; earlier ticks expire
+ *        at the next one
+ */
+void
+TimerWheel::Schedule (uint32_t id, uint64_t tick)
+{
+  // The current tick has already been processed, and the wheel only spans
+  // SLOTS^LEVELS ticks
+  uint64_t span = (uint64_t (1) << (SLOT_BITS * LEVELS)) - 1;
+  m_tick[id] = std::min (std::max (tick, m_current + 1), m_current + span);
+  m_scheduled[id] = true;
+  m_count++;
+  Place (id);
+}
+
+/**
+ * \brief Put an identifier in the slot of its tick
+ * \param id Identifier with its tick already set
+ */
+void
+TimerWheel::Place (uint32_t id)
+{
+  // Lowest level whose span covers the delay; the slot is taken from the
+  // bits of the absolute tick, so it is reached exactly once in time
+  uint64_t delay = m_tick[id] - m_current;
+  uint32_t level = 0;
+  while (level + 1 < LEVELS && delay >= (uint64_t (1) << (SLOT_BITS * (level + 1))))
+    {
+      level++;
+    }
+  uint32_t slot = level * SLOTS + ((m_tick[id] >> (SLOT_BITS * level)) & (SLOTS - 1));
+  m_next[id] = m_slotHead[slot];
+  m_slotHead[slot] = id;
+}
+
+/**
+ * \brief Move to the next tick and collect the identifiers that expire
+ * \param expired Receives the expired identifiers
+ */
+void
+TimerWheel::Advance (std::vector<uint32_t>& expired)
+{
+  m_current++;
+
+  // Entering a slot of a higher level spreads it over the levels below,
+  // starting from the highest level whose slot boundary is crossed
+  uint32_t top = 0;
+  while (top + 1 < LEVELS && (m_current & ((uint64_t (1) << (SLOT_BITS * (top + 1))) - 1)) == 0)
+    {
+      top++;
+    }
+  for (uint32_t level = top; level > 0; level--)
+    {
+      uint32_t slot = level * SLOTS + ((m_current >> (SLOT_BITS * level)) & (SLOTS - 1));
+      uint32_t id = m_slotHead[slot];
+      m_slotHead[slot] = NONE;
+      while (id != NONE)
+        {
+          uint32_t next = m_next[id];
+          Place (id);
+          id = next;
+        }
+    }
+
+  // Every identifier left in the current slot of the first level expires now
+  uint32_t slot = m_current & (SLOTS - 1);
+  uint32_t id = m_slotHead[slot];
+  m_slotHead[slot] = NONE;
+  while (id != NONE)
+    {
+      uint32_t next = m_next[id];
+      m_scheduled[id] = false;
+      m_count--;
+      expired.push_back (id);
+      id = next;
+    }
+}
+
+/**
+ * \brief Check whether an identifier is scheduled
+ * \param id Identifier to check
+ * \return true if the identifier is scheduled
+ */
+bool
+TimerWheel::Contains (uint32_t id) const
+{
+  return m_scheduled[id];
+}
+
+/**
+ * \brief Check whether no identifier is scheduled
+ * \return true if the wheel is empty
+ */
+bool
+TimerWheel::IsEmpty () const
+{
+  return m_count == 0;
+}
+
+/**
+ * \brief Get the current tick
+ * \return The last tick reached by Advance or Reset
+ */
+uint64_t
+TimerWheel::GetCurrentTick () const
+{
+  return m_current;
+}
+
+} // namespace ns3
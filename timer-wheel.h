@@ -0,0 +1,100 @@
+/*
+ * This program implements a hierarchical timing wheel of identifiers.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Hierarchical timing wheel that expires identifiers at a given tick
+ *
+ * Identifiers 0..n-1 are scheduled at an absolute tick and returned by
+ * Advance when the wheel reaches it. As in the Varghese and Lauck
+ * hierarchical wheel, level l has SLOTS slots of SLOTS^l ticks each; an
+ * identifier is put on the lowest level whose span covers its delay, and
+ * the slot of a higher level is cascaded into the lower levels when the
+ * wheel enters it. Schedule and the expiry of an identifier are O(1),
+ * whatever the delay, and a tick costs O(1) plus the identifiers it
+ * moves. Delays beyond the span of the wheel are cut to that span.
+ */
+class TimerWheel
+{
+public:
+  static constexpr uint32_t NONE = 0xffffffff;   //!< No identifier
+  static constexpr uint32_t SLOT_BITS = 6;       //!< log2 of the slots per level
+  static constexpr uint32_t SLOTS = 1u << SLOT_BITS; //!< Slots per level
+  static constexpr uint32_t LEVELS = 4;          //!< Number of levels
+
+  /**
+   * \brief Constructor - creates an empty wheel at tick 0 with no identifiers
+   */
+  TimerWheel ();
+
+  /**
+   * \brief Grow the range of identifiers, keeping the scheduled ones
+   * \param n Identifiers range from 0 to n - 1
+   */
+  void Resize (uint32_t n);
+
+  /**
+   * \brief Move an empty wheel to a tick
+   * \param tick The new current tick
+   */
+  void Reset (uint64_t tick);
+
+  /**
+   * \brief Schedule an identifier
+   * \param id Identifier, not already scheduled
+   * \param tick Tick at which the identifier expires; earlier ticks expire
+   *        at the next one
+   */
+  void Schedule (uint32_t id, uint64_t tick);
+
+  /**
+   * \brief Move to the next tick and collect the identifiers that expire
+   * \param expired Receives the expired identifiers
+   */
+  void Advance (std::vector<uint32_t>& expired);
+
+  /**
+   * \brief Check whether an identifier is scheduled
+   * \param id Identifier to check
+   * \return true if the identifier is scheduled
+   */
+  bool Contains (uint32_t id) const;
+
+  /**
+   * \brief Check whether no identifier is scheduled
+   * \return true if the wheel is empty
+   */
+  bool IsEmpty () const;
+
+  /**
+   * \brief Get the current tick
+   * \return The last tick reached by Advance or Reset
+   */
+  uint64_t GetCurrentTick () const;
+
+private:
+  /**
+   * \brief Put an identifier in the slot of its tick
+   * \param id Identifier with its tick already set
+   */
+  void Place (uint32_t id);
+
+  std::vector<uint32_t> m_slotHead;     //!< First identifier of each slot, level by level
+  std::vector<uint32_t> m_next;         //!< Next identifier in the same slot
+  std::vector<uint64_t> m_tick;         //!< Expiry tick of each identifier
+  std::vector<bool> m_scheduled;        //!< Whether each identifier is scheduled
+  uint64_t m_current;                   //!< Current tick
+  uint32_t m_count;                     //!< Number of scheduled identifiers
+};
+
+} // namespace ns3
+
+#endif // TIMER_WHEEL_H
@@ -4,12 +4,15 @@
  */
 
 #include "ns3/core-module.h"
+#include "ns3/abort.h"
 #include "ns3/log.h"
 #include "filter.h"
 #include "traffic-class.h"
+#include "diff-serve.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/tcp-header.h"
 #include "ns3/udp-header.h"
+#include <algorithm>
 
 namespace ns3 {
 
@@ -17,12 +20,244 @@ namespace ns3 {
  * \brief Constructor - initializes default values
  */
 TrafficClass::TrafficClass () 
-  : m_packets (0), 
+  : m_head (0),
+    m_packets (0), 
     m_maxPackets (100), 
+    m_bytes (0),
+    m_maxBytes (0),
     m_weight (0), 
     m_priority (0),
-    m_isDefault (false)
+    m_isDefault (false),
+    m_rate (0),
+    m_burst (0),
+    m_tokens (0),
+    m_aqm (nullptr),
+    m_pendingFlow (0),
+    m_pendingEvict (false),
+    m_pendingEvictSize (0),
+    m_owner (nullptr)
 {
+  m_ring.resize (m_maxPackets);
+}
+
+/**
+ * \brief Destructor - releases the AQM
+ */
+TrafficClass::~TrafficClass ()
+{
+  delete m_aqm;
+}
+
+/**
+ * \brief Make this class a scheduler node
+ * \param child Scheduler holding the classes below this one
+ */
+void
+TrafficClass::SetChild (Ptr<DiffServ> child)
+{
+  m_child = child;
+
+  // Packets of a node are stored by the child, so the ring is not needed
+  std::vector<QueueSlot> ().swap (m_ring);
+  m_head = 0;
+}
+
+/**
+ * \brief Get the child scheduler of a node
+ * \return The child scheduler, or nullptr for a leaf class
+ */
+Ptr<DiffServ>
+TrafficClass::GetChild () const
+{
+  return m_child;
+}
+
+/**
+ * \brief Set the scheduler this class was added to
+ * \param owner The DiffServ holding the class
+ */
+void
+TrafficClass::SetOwner (DiffServ* owner)
+{
+  m_owner = owner;
+  NotifyRulesetChanged ();
+}
+
+/**
+ * \brief Report a change to the filters or default flag to the owner
+ *
+ * The filters of the class are registered with the owner too, so that
+ * elements added to them later are reported as well.
+ */
+void
+TrafficClass::NotifyRulesetChanged ()
+{
+  if (m_owner == nullptr)
+    {
+      return;
+    }
+  for (Filter* filter : m_filters)
+    {
+      filter->AddOwner (m_owner);
+    }
+  m_owner->NotifyRulesetChanged ();
+}
+
+/**
+ * \brief Get the child class the child scheduler would serve next
+ * \return The class; this node must not be empty
+ */
+TrafficClass*
+TrafficClass::GetScheduledChild () const
+{
+  return m_child->GetClasses ()[m_child->GetSchedule ().index];
+}
+
+/**
+ * \brief Get the flow queue of a packet
+ * \param key The parsed header fields of the packet
+ * \return Index of the flow queue
+ */
+uint32_t
+TrafficClass::GetFlow (const FlowKey& key) const
+{
+  uint64_t hash = key.srcIp.Get ();
+  hash = hash * 0x9e3779b97f4a7c15ULL ^ key.dstIp.Get ();
+  hash = hash * 0x9e3779b97f4a7c15ULL ^ ((uint32_t (key.srcPort) << 16) | key.dstPort);
+  hash = hash * 0x9e3779b97f4a7c15ULL ^ key.protocol;
+  hash *= 0x9e3779b97f4a7c15ULL;
+
+  // Scale the top 32 bits to the number of flows, which need not be a power of 2
+  return ((hash >> 32) * m_flowQueues.GetFlowCount ()) >> 32;
+}
+
+/**
+ * \brief Check whether this class and, for a node, the child class of
+ *        the packet would accept it
+ * \param key The parsed header fields of the packet
+ * \param size Packet size in bytes
+ * \return true if the packet fits the limits along its path
+ *
+ * A full flow-queued class still accepts the packet if evicting the head
+ * packet of its largest flow, when that is another flow, makes it fit.
+ * A node holds the packets of its children, so it is full whenever the
+ * class of the packet is; when that class evicts, the node keeps its
+ * packet count and only its byte limit is checked, after the eviction.
+ */
+bool
+TrafficClass::CanStore (const FlowKey& key, uint32_t size)
+{
+  m_pendingEvict = false;
+  if (m_child != nullptr)
+    {
+      if (!m_child->CanStore (key, size))
+        {
+          return false;
+        }
+      m_pendingEvict = m_child->GetPendingEviction (m_pendingEvictSize);
+      if (!m_pendingEvict)
+        {
+          return CanEnqueue (size);
+        }
+      return m_maxBytes == 0 || m_bytes - m_pendingEvictSize + size <= m_maxBytes;
+    }
+
+  if (m_flowQueues.GetFlowCount () > 0)
+    {
+      m_pendingFlow = GetFlow (key);
+    }
+  if (!CanEnqueue (size))
+    {
+      uint32_t largest = m_flowQueues.GetFlowCount () > 0 ? m_flowQueues.GetLargestFlow () : FlowQueues::NONE;
+      if (largest == FlowQueues::NONE || largest == m_pendingFlow)
+        {
+          return false;
+        }
+      m_pendingEvictSize = m_ring[m_flowQueues.GetFlowHead (largest)].size;
+      if (m_maxBytes != 0 && m_bytes - m_pendingEvictSize + size > m_maxBytes)
+        {
+          return false;
+        }
+      m_pendingEvict = true;
+    }
+  return m_aqm == nullptr || !m_aqm->DropOnEnqueue (*this, size);
+}
+
+/**
+ * \brief Check whether the last successful CanStore makes room by evicting a packet
+ * \param size Set to the size of the packet to evict
+ * \return true if Store will evict a packet, here or in the child class
+ */
+bool
+TrafficClass::GetPendingEviction (uint32_t& size) const
+{
+  size = m_pendingEvictSize;
+  return m_pendingEvict;
+}
+
+/**
+ * \brief Store a packet accepted by CanStore
+ * \param key The parsed header fields of the packet
+ * \param p Packet to store
+ * \param handle Position of the packet in the root DiffServ base-class container
+ * \return The descriptor of a packet evicted to make room, with drop
+ *         set, whose packet is nullptr if none was
+ */
+QueueSlot
+TrafficClass::Store (const FlowKey& key, Ptr<Packet> p, std::list<Ptr<Packet>>::const_iterator handle)
+{
+  QueueSlot evicted;
+  evicted.drop = false;
+
+  if (m_child == nullptr)
+    {
+      // CanStore made sure that the head of the largest flow makes room
+      if (!CanEnqueue (p->GetSize ()))
+        {
+          uint32_t index = m_flowQueues.Evict (m_flowQueues.GetLargestFlow ());
+          evicted = m_ring[index];
+          evicted.drop = true;
+          m_ring[index].packet = nullptr;
+          m_packets--;
+          m_bytes -= evicted.size;
+        }
+      Enqueue (p, handle, m_pendingFlow);
+      return evicted;
+    }
+
+  // A node only counts the packet; the child class of the packet stores it
+  evicted = m_child->Store (key, p, handle);
+  m_packets++;
+  m_bytes += p->GetSize ();
+  if (evicted.packet != nullptr)
+    {
+      m_packets--;
+      m_bytes -= evicted.size;
+    }
+  return evicted;
+}
+
+/**
+ * \brief Remove the next packet of this class, chosen by the child
+ *        scheduler for a node
+ * \return The descriptor of the packet; the class must not be empty
+ */
+QueueSlot
+TrafficClass::TakeSlot ()
+{
+  if (m_child == nullptr)
+    {
+      return DequeueSlot ();
+    }
+
+  QueueSlot slot = m_child->TakeScheduled ();
+  if (!slot.drop)
+    {
+      m_sojourn.Record (Simulator::Now () - slot.enqueueTime);
+    }
+  m_packets--;
+  m_bytes -= slot.size;
+  return slot;
 }
 
 /**
@@ -33,6 +268,7 @@ void
 TrafficClass::SetIsDefault (bool isDefault)
 {
   m_isDefault = isDefault;
+  NotifyRulesetChanged ();
 }
 
 /**
@@ -45,6 +281,17 @@ TrafficClass::IsDefault () const
   return m_isDefault;
 }
 
+/**
+ * \brief Check whether a packet of the given size would be accepted
+ * \param size Packet size in bytes
+ * \return true if the packet fits within the packet and byte limits
+ */
+bool
+TrafficClass::CanEnqueue (uint32_t size) const
+{
+  return m_packets < m_maxPackets && (m_maxBytes == 0 || m_bytes + size <= m_maxBytes);
+}
+
 /**
  * \brief Enqueue a packet into this traffic class
  * \param pkt Packet to enqueue
@@ -53,11 +300,59 @@ TrafficClass::IsDefault () const
 bool 
 TrafficClass::Enqueue (Ptr<Packet> pkt)
 {
-  // Ensure the packet count is less than max
-  if (m_packets < m_maxPackets)
+  return Enqueue (pkt, std::list<Ptr<Packet>>::const_iterator ());
+}
+
+/**
+ * \brief Enqueue a packet that is also tracked by the owning DiffServ
+ * \param pkt Packet to enqueue
+ * \param handle Position of the packet in the DiffServ base-class container
+ * \return true if the packet was successfully enqueued
+ */
+bool
+TrafficClass::Enqueue (Ptr<Packet> pkt, std::list<Ptr<Packet>>::const_iterator handle)
+{
+  // Without a parsed header, every packet goes to the first flow queue
+  return Enqueue (pkt, handle, 0);
+}
+
+/**
+ * \brief Enqueue a packet into one flow queue
+ * \param pkt Packet to enqueue
+ * \param handle Position of the packet in the DiffServ base-class container
+ * \param flow Flow queue of the packet, ignored without flow queues
+ * \return true if the packet was successfully enqueued
+ */
+bool
+TrafficClass::Enqueue (Ptr<Packet> pkt, std::list<Ptr<Packet>>::const_iterator handle, uint32_t flow)
+{
+  uint32_t size = pkt->GetSize ();
+
+  // Ensure the packet count is less than max and the packet fits the byte limit
+  if (CanEnqueue (size))
     {
-      m_queue.push (pkt);
+      uint32_t tail;
+      if (m_flowQueues.GetFlowCount () > 0)
+        {
+          tail = m_flowQueues.Push (flow, size);
+        }
+      else
+        {
+          tail = m_head + m_packets;
+          if (tail >= m_maxPackets)
+            {
+              tail -= m_maxPackets;
+            }
+        }
+
+      QueueSlot& slot = m_ring[tail];
+      slot.packet = pkt;
+      slot.size = size;
+      slot.enqueueTime = Simulator::Now ();
+      slot.handle = handle;
+      slot.drop = false;
       m_packets++;
+      m_bytes += size;
       return true;
     }
 
@@ -72,20 +367,69 @@ Ptr<Packet>
 TrafficClass::Dequeue ()
 {
   // Return null pointer on empty queue
-  if (m_queue.empty ())
+  if (IsEmpty ())
     {
       std::cout << "Be aware that the queue is empty." << std::endl;
       return nullptr;
     }
 
-  // Dequeue the packet and update the packet count
-  Ptr<Packet> pkt = m_queue.front ();
-  
-  // Pop the packet from the queue and decrement the packet count
-  m_queue.pop ();
+  // Packets dropped by the AQM are discarded here
+  QueueSlot slot;
+  do
+    {
+      slot = DequeueSlot ();
+    }
+  while (slot.drop);
+  return slot.packet;
+}
+
+/**
+ * \brief Dequeue the head slot from this traffic class
+ * \return The descriptor of the dequeued packet, whose packet is nullptr
+ *         if the queue is empty
+ */
+QueueSlot
+TrafficClass::DequeueSlot ()
+{
+  QueueSlot slot;
+  slot.drop = false;
+  if (IsEmpty ())
+    {
+      return slot;
+    }
+
+  // Move the head slot out so the ring holds no reference to the packet,
+  // then advance the head, or let the flow queues pick the next flow
+  if (m_flowQueues.GetFlowCount () > 0)
+    {
+      uint32_t index = m_flowQueues.Pop ();
+      slot = m_ring[index];
+      m_ring[index].packet = nullptr;
+    }
+  else
+    {
+      slot = m_ring[m_head];
+      m_ring[m_head].packet = nullptr;
+      if (++m_head == m_maxPackets)
+        {
+          m_head = 0;
+        }
+    }
+
+  // Decrement the packet and byte counts
+  m_bytes -= slot.size;
   m_packets--;
+
+  // Let the AQM judge the packet, then record how long a sent packet
+  // waited in this class
+  Time sojourn = Simulator::Now () - slot.enqueueTime;
+  slot.drop = m_aqm != nullptr && m_aqm->DropOnDequeue (sojourn, m_bytes);
+  if (!slot.drop)
+    {
+      m_sojourn.Record (sojourn);
+    }
   
-  return pkt;
+  return slot;
 }
 
 /**
@@ -108,6 +452,80 @@ TrafficClass::GetPackets () const
   return m_packets;
 }
 
+/**
+ * \brief Get the current number of bytes in the queue
+ * \return Number of bytes
+ */
+uint32_t
+TrafficClass::GetBytes () const
+{
+  return m_bytes;
+}
+
+/**
+ * \brief Get the size of the packet at the head of the queue
+ * \return Size in bytes of the next packet, or 0 if the queue is empty
+ */
+uint32_t
+TrafficClass::GetHeadSize () const
+{
+  if (IsEmpty ())
+    {
+      return 0;
+    }
+  return m_child != nullptr ? GetScheduledChild ()->GetHeadSize () : GetHeadSlot ().size;
+}
+
+/**
+ * \brief Get the time at which the packet at the head of the queue was enqueued
+ * \return Enqueue time of the next packet; the queue must not be empty
+ */
+Time
+TrafficClass::GetHeadEnqueueTime () const
+{
+  return m_child != nullptr ? GetScheduledChild ()->GetHeadEnqueueTime () : GetHeadSlot ().enqueueTime;
+}
+
+/**
+ * \brief Get the slot of the packet to dequeue next
+ * \return The slot; the queue must not be empty
+ */
+const QueueSlot&
+TrafficClass::GetHeadSlot () const
+{
+  return m_ring[m_flowQueues.GetFlowCount () > 0 ? m_flowQueues.Head () : m_head];
+}
+
+/**
+ * \brief Get the histogram of sojourn times of dequeued packets
+ * \return The sojourn-time histogram
+ */
+const SojournHistogram&
+TrafficClass::GetSojournHistogram () const
+{
+  return m_sojourn;
+}
+
+/**
+ * \brief Set the maximum number of bytes allowed in the queue
+ * \param maxBytes Maximum number of bytes, or 0 for no byte limit
+ */
+void
+TrafficClass::SetMaxBytes (uint32_t maxBytes)
+{
+  m_maxBytes = maxBytes;
+}
+
+/**
+ * \brief Get the maximum number of bytes allowed in the queue
+ * \return Maximum number of bytes, or 0 if there is no byte limit
+ */
+uint32_t
+TrafficClass::GetMaxBytes () const
+{
+  return m_maxBytes;
+}
+
 /**
  * \brief Get the filters for this traffic class
  * \return Vector of filters
@@ -118,6 +536,155 @@ TrafficClass::GetFilters () const
   return m_filters;
 }
 
+/**
+ * \brief Set the committed rate of this traffic class
+ * \param rate Rate of the token bucket, or 0 for an unshaped class
+ */
+void
+TrafficClass::SetRate (DataRate rate)
+{
+  m_rate = rate;
+}
+
+/**
+ * \brief Get the committed rate of this traffic class
+ * \return Rate of the token bucket, 0 for an unshaped class
+ */
+DataRate
+TrafficClass::GetRate () const
+{
+  return m_rate;
+}
+
+/**
+ * \brief Set the burst size of this traffic class and fill its bucket
+ * \param burst Size of the token bucket in bytes
+ */
+void
+TrafficClass::SetBurst (uint32_t burst)
+{
+  m_burst = burst;
+  m_tokens = burst;
+}
+
+/**
+ * \brief Get the burst size of this traffic class
+ * \return Size of the token bucket in bytes
+ */
+uint32_t
+TrafficClass::GetBurst () const
+{
+  return m_burst;
+}
+
+/**
+ * \brief Check whether the class is shaped by a token bucket
+ * \return true if a rate is set
+ */
+bool
+TrafficClass::IsShaped () const
+{
+  return m_rate.GetBitRate () > 0;
+}
+
+/**
+ * \brief Add the tokens earned since the last update
+ * \param now The current time
+ */
+void
+TrafficClass::UpdateTokens (Time now)
+{
+  double earned = (now - m_tokenTime).GetSeconds () * m_rate.GetBitRate () / 8;
+  m_tokens = std::min (m_tokens + earned, static_cast<double> (m_burst));
+  m_tokenTime = now;
+}
+
+/**
+ * \brief Check whether the head packet conforms to the token bucket
+ * \return true if the bucket holds enough tokens for the head packet
+ *
+ * A full bucket always lets the head packet through, so packets larger
+ * than the burst are sent at the rate instead of being held forever.
+ */
+bool
+TrafficClass::HasTokens () const
+{
+  return m_tokens >= std::min (GetHeadSize (), m_burst);
+}
+
+/**
+ * \brief Charge a sent packet to the token bucket
+ * \param size Size of the packet in bytes
+ */
+void
+TrafficClass::ConsumeTokens (uint32_t size)
+{
+  m_tokens -= size;
+}
+
+/**
+ * \brief Get the time until the head packet conforms to the token bucket
+ * \return Delay from the last update
+ */
+Time
+TrafficClass::GetTokenDelay () const
+{
+  double missing = std::min (GetHeadSize (), m_burst) - m_tokens;
+  if (missing <= 0)
+    {
+      return Seconds (0);
+    }
+  return Seconds (missing * 8 / m_rate.GetBitRate ());
+}
+
+/**
+ * \brief Set the active queue management of this traffic class
+ * \param aqm The AQM, owned by the class from now on, or nullptr for tail drop only
+ */
+void
+TrafficClass::SetAqm (Aqm* aqm)
+{
+  delete m_aqm;
+  m_aqm = aqm;
+}
+
+/**
+ * \brief Get the active queue management of this traffic class
+ * \return The AQM, or nullptr if the class only drops at its limits
+ */
+Aqm*
+TrafficClass::GetAqm () const
+{
+  return m_aqm;
+}
+
+/**
+ * \brief Split this traffic class into flow queues
+ * \param flows Number of flow queues, or 0 for a single FIFO
+ * \param quantum Bytes each flow may send per round
+ *
+ * The ring slots become the pool of the flow queues, so no memory is
+ * allocated per flow or per packet afterwards. The class must be empty.
+ */
+void
+TrafficClass::SetFlowQueues (uint32_t flows, uint32_t quantum)
+{
+  NS_ABORT_MSG_IF (m_packets > 0, "Cannot change the flow queues of a class holding " << m_packets << " packets");
+
+  m_flowQueues.Reset (flows, flows > 0 ? m_ring.size () : 0, quantum);
+  m_head = 0;
+}
+
+/**
+ * \brief Get the number of flow queues of this traffic class
+ * \return Number of flow queues, 0 for a single FIFO
+ */
+uint32_t
+TrafficClass::GetFlowQueues () const
+{
+  return m_flowQueues.GetFlowCount ();
+}
+
 /**
  * \brief Set the filters for this traffic class
  * \param filters Vector of filters
@@ -127,6 +694,7 @@ TrafficClass::SetFilters (const std::vector<Filter*>& filters)
 {
   m_filters.clear ();
   m_filters = filters;
+  NotifyRulesetChanged ();
 }
 
 /**
@@ -150,9 +718,12 @@ TrafficClass::Peek () const
     {
       return nullptr;
     }
+  if (m_child != nullptr)
+    {
+      return GetScheduledChild ()->Peek ();
+    }
   
-  Ptr<Packet> pkt = m_queue.front ();
-  return pkt;
+  return GetHeadSlot ().packet;
 }
 
 /**
@@ -163,15 +734,48 @@ void
 TrafficClass::AddFilter (Filter *filter)
 {
   m_filters.push_back (filter);
+  NotifyRulesetChanged ();
 }
 
 /**
  * \brief Set the maximum number of packets allowed in the queue
  * \param maxPackets Maximum number of packets
+ *
+ * The ring buffer is sized here, once, so that enqueue and dequeue never
+ * allocate. Queued packets are moved to the front of the new ring, so
+ * the limit may not drop below them. A flow-queued class must be empty.
  */
 void 
 TrafficClass::SetMaxPackets (uint32_t maxPackets)
 {
+  // A node has no ring of its own
+  if (m_child != nullptr)
+    {
+      m_maxPackets = maxPackets;
+      return;
+    }
+
+  NS_ABORT_MSG_IF (maxPackets < m_packets,
+                   "Cannot limit a class holding " << m_packets << " packets to " << maxPackets);
+
+  // The flow queues of an empty class are rebuilt over the new pool
+  if (m_flowQueues.GetFlowCount () > 0)
+    {
+      NS_ABORT_MSG_IF (m_packets > 0, "Cannot resize the flow queues of a class holding " << m_packets << " packets");
+      m_ring.assign (maxPackets, QueueSlot ());
+      m_flowQueues.Reset (m_flowQueues.GetFlowCount (), maxPackets, m_flowQueues.GetQuantum ());
+      m_maxPackets = maxPackets;
+      return;
+    }
+
+  std::vector<QueueSlot> ring (maxPackets);
+  for (uint32_t i = 0; i < m_packets; i++)
+    {
+      ring[i] = m_ring[(m_head + i) % m_maxPackets];
+    }
+
+  m_ring.swap (ring);
+  m_head = 0;
   m_maxPackets = maxPackets;
 }
 
@@ -217,11 +821,11 @@ TrafficClass::GetPriority () const
 
 /**
  * \brief Check if a packet matches this traffic class's filters
- * \param pkt Packet to check
+ * \param key The parsed header fields of the packet to check
  * \return true if the packet matches, false otherwise
  */
 bool 
-TrafficClass::Match (Ptr<Packet> pkt) const
+TrafficClass::Match (const FlowKey& key) const
 {
   // If no filters, match everything
   if (m_filters.empty ())
@@ -232,7 +836,7 @@ TrafficClass::Match (Ptr<Packet> pkt) const
   // Check if the packet matches any of the filters (OR logic)
   for (Filter *filter : m_filters)
     {
-      bool matches = filter->Match (pkt);
+      bool matches = filter->Match (key);
       if (matches)
         {
           return true;
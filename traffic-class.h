@@ -6,18 +6,65 @@
 #ifndef TRAFFIC_CLASS_H
 #define TRAFFIC_CLASS_H
 
+#include "aqm.h"
 #include "filter.h"
+#include "flow-queues.h"
+#include "sojourn-histogram.h"
 #include "ns3/packet.h"
-#include <queue>
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include <list>
+#include <vector>
 
 namespace ns3 {
 
+class DiffServ;
+
+/**
+ * \brief Descriptor of a packet stored in a TrafficClass
+ *
+ * Slots live in a ring buffer preallocated by TrafficClass::SetMaxPackets,
+ * so the size and arrival time of a packet are kept next to its pointer.
+ * A flow-queued class uses the same slots as a pool shared by its flows.
+ */
+struct QueueSlot
+{
+  Ptr<Packet> packet;      //!< The queued packet
+  uint32_t size;           //!< Packet size in bytes
+  Time enqueueTime;        //!< Simulation time at which the packet was enqueued
+  std::list<Ptr<Packet>>::const_iterator handle; //!< Position in the owning DiffServ base-class container
+  bool drop;               //!< Set on a dequeued slot whose packet the AQM of the class dropped
+};
+
 /**
  * \brief A traffic class for QoS packet scheduling
  *
  * This class represents a traffic class that can be used with
  * different QoS scheduling algorithms. It maintains a queue of
  * packets and has associated parameters like priority and weight.
+ *
+ * A class can instead be a scheduler node: with SetChild, its packets are
+ * classified again and stored in the classes of a child DiffServ, whose
+ * scheduler picks the packet this class hands to its own scheduler. The
+ * packet and byte limits of the node apply to the whole subtree.
+ *
+ * A class with a rate is shaped by a token bucket of that rate and of
+ * the configured burst size. Its head packet may only be sent once the
+ * bucket holds as many bytes as the packet, or is full; the DiffServ of
+ * the class holds the class back from its scheduler until then.
+ *
+ * A leaf class may also have an active queue management (SetAqm), which
+ * drops packets at enqueue (CanStore fails) or marks the dequeued slot
+ * for dropping, so that the standing queue stays short whatever the
+ * packet and byte limits.
+ *
+ * With SetFlowQueues, a leaf class hashes the 5-tuple of its packets
+ * into a fixed number of flow queues instead of keeping one FIFO. The
+ * flows share the slots and the limits of the class and are served by
+ * an inner deficit round robin (FlowQueues), so a heavy flow no longer
+ * delays the other flows of its class. When the class is full, the head
+ * packet of its largest flow is evicted to make room for a packet of
+ * another flow.
  */
 class TrafficClass 
 {
@@ -30,7 +77,10 @@ public:
   /**
    * \brief Virtual destructor
    */
-  virtual ~TrafficClass () = default;
+  virtual ~TrafficClass ();
+
+  TrafficClass (const TrafficClass&) = delete;
+  TrafficClass& operator= (const TrafficClass&) = delete;
 
   /**
    * \brief Enqueue a packet into this traffic class
@@ -38,12 +88,94 @@ public:
    * \return true if the packet was successfully enqueued
    */
   bool Enqueue (Ptr<Packet> p);
+
+  /**
+   * \brief Enqueue a packet that is also tracked by the owning DiffServ
+   * \param p Packet to enqueue
+   * \param handle Position of the packet in the DiffServ base-class container
+   * \return true if the packet was successfully enqueued
+   */
+  bool Enqueue (Ptr<Packet> p, std::list<Ptr<Packet>>::const_iterator handle);
+
+  /**
+   * \brief Check whether a packet of the given size would be accepted
+   * \param size Packet size in bytes
+   * \return true if the packet fits within the packet and byte limits
+   */
+  bool CanEnqueue (uint32_t size) const;
   
+  /**
+   * \brief Check whether this class and, for a node, the child class of
+   *        the packet would accept it
+   * \param key The parsed header fields of the packet
+   * \param size Packet size in bytes
+   * \return true if the packet fits the limits along its path
+   */
+  bool CanStore (const FlowKey& key, uint32_t size);
+
+  /**
+   * \brief Check whether the last successful CanStore makes room by evicting a packet
+   * \param size Set to the size of the packet to evict
+   * \return true if Store will evict a packet, here or in the child class
+   */
+  bool GetPendingEviction (uint32_t& size) const;
+
+  /**
+   * \brief Store a packet accepted by CanStore
+   * \param key The parsed header fields of the packet
+   * \param p Packet to store
+   * \param handle Position of the packet in the root DiffServ base-class container
+   * \return The descriptor of a packet evicted to make room, with drop
+   *         set, whose packet is nullptr if none was
+   */
+  QueueSlot Store (const FlowKey& key, Ptr<Packet> p, std::list<Ptr<Packet>>::const_iterator handle);
+
+  /**
+   * \brief Remove the next packet of this class, chosen by the child
+   *        scheduler for a node
+   * \return The descriptor of the packet; the class must not be empty
+   */
+  QueueSlot TakeSlot ();
+
+  /**
+   * \brief Make this class a scheduler node
+   * \param child Scheduler holding the classes below this one
+   *
+   * Must be called before any packet is stored. Packets of a node are only
+   * reachable through CanStore, Store and TakeSlot.
+   */
+  void SetChild (Ptr<DiffServ> child);
+
+  /**
+   * \brief Get the child scheduler of a node
+   * \return The child scheduler, or nullptr for a leaf class
+   */
+  Ptr<DiffServ> GetChild () const;
+
+  /**
+   * \brief Set the scheduler this class was added to
+   * \param owner The DiffServ holding the class
+   *
+   * Changes to the filters and the default flag of the class are then
+   * reported to the owner, which rebuilds its classifier.
+   */
+  void SetOwner (DiffServ* owner);
+
   /**
    * \brief Dequeue a packet from this traffic class
    * \return The dequeued packet, or nullptr if the queue is empty
    */
   Ptr<Packet> Dequeue ();
+
+  /**
+   * \brief Dequeue the head slot from this traffic class
+   * \return The descriptor of the dequeued packet, whose packet is nullptr
+   *         if the queue is empty
+   *
+   * The AQM of the class, if any, judges the packet: a dropped packet is
+   * returned with drop set and its sojourn time is not recorded.
+   */
+  QueueSlot DequeueSlot ();
   
   /**
    * \brief Peek at the next packet without removing it
@@ -59,10 +191,10 @@ public:
   
   /**
    * \brief Check if a packet matches this traffic class's filters
-   * \param p Packet to check
+   * \param key The parsed header fields of the packet to check
    * \return true if the packet matches, false otherwise
    */
-  bool Match (Ptr<Packet> p) const;
+  bool Match (const FlowKey& key) const;
 
   /**
    * \brief Get the current number of packets in the queue
@@ -70,9 +202,49 @@ public:
    */
   uint32_t GetPackets () const;
 
+  /**
+   * \brief Get the current number of bytes in the queue
+   * \return Number of bytes
+   */
+  uint32_t GetBytes () const;
+
+  /**
+   * \brief Get the size of the packet at the head of the queue
+   * \return Size in bytes of the next packet, or 0 if the queue is empty
+   */
+  uint32_t GetHeadSize () const;
+
+  /**
+   * \brief Get the time at which the packet at the head of the queue was enqueued
+   * \return Enqueue time of the next packet; the queue must not be empty
+   */
+  Time GetHeadEnqueueTime () const;
+
+  /**
+   * \brief Get the histogram of sojourn times of dequeued packets
+   * \return The sojourn-time histogram
+   */
+  const SojournHistogram& GetSojournHistogram () const;
+
+  /**
+   * \brief Set the maximum number of bytes allowed in the queue
+   * \param maxBytes Maximum number of bytes, or 0 for no byte limit
+   */
+  void SetMaxBytes (uint32_t maxBytes);
+
+  /**
+   * \brief Get the maximum number of bytes allowed in the queue
+   * \return Maximum number of bytes, or 0 if there is no byte limit
+   */
+  uint32_t GetMaxBytes () const;
+
   /**
    * \brief Set the maximum number of packets allowed in the queue
    * \param maxPackets Maximum number of packets
+   *
+   * The ring buffer is resized to hold exactly maxPackets slots. Queued
+   * packets are kept, so the limit may not drop below them, and a class
+   * with flow queues must be empty.
    */
   void SetMaxPackets (uint32_t maxPackets);
   
@@ -106,6 +278,91 @@ public:
    */
   uint32_t GetPriority () const;
 
+  /**
+   * \brief Set the committed rate of this traffic class
+   * \param rate Rate of the token bucket, or 0 for an unshaped class
+   */
+  void SetRate (DataRate rate);
+
+  /**
+   * \brief Get the committed rate of this traffic class
+   * \return Rate of the token bucket, 0 for an unshaped class
+   */
+  DataRate GetRate () const;
+
+  /**
+   * \brief Set the burst size of this traffic class and fill its bucket
+   * \param burst Size of the token bucket in bytes
+   *
+   * With a burst of 0 the class never exceeds its rate, even briefly.
+   */
+  void SetBurst (uint32_t burst);
+
+  /**
+   * \brief Get the burst size of this traffic class
+   * \return Size of the token bucket in bytes
+   */
+  uint32_t GetBurst () const;
+
+  /**
+   * \brief Check whether the class is shaped by a token bucket
+   * \return true if a rate is set
+   */
+  bool IsShaped () const;
+
+  /**
+   * \brief Add the tokens earned since the last update
+   * \param now The current time
+   */
+  void UpdateTokens (Time now);
+
+  /**
+   * \brief Check whether the head packet conforms to the token bucket
+   * \return true if the bucket holds enough tokens for the head packet
+   */
+  bool HasTokens () const;
+
+  /**
+   * \brief Charge a sent packet to the token bucket
+   * \param size Size of the packet in bytes
+   */
+  void ConsumeTokens (uint32_t size);
+
+  /**
+   * \brief Get the time until the head packet conforms to the token bucket
+   * \return Delay from the last update
+   */
+  Time GetTokenDelay () const;
+
+  /**
+   * \brief Set the active queue management of this traffic class
+   * \param aqm The AQM, owned by the class from now on, or nullptr for tail drop only
+   *
+   * Only leaf classes use their AQM.
+   */
+  void SetAqm (Aqm* aqm);
+
+  /**
+   * \brief Get the active queue management of this traffic class
+   * \return The AQM, or nullptr if the class only drops at its limits
+   */
+  Aqm* GetAqm () const;
+
+  /**
+   * \brief Split this traffic class into flow queues
+   * \param flows Number of flow queues, or 0 for a single FIFO
+   * \param quantum Bytes each flow may send per round
+   *
+   * Only leaf classes use flow queues. The class must be empty.
+   */
+  void SetFlowQueues (uint32_t flows, uint32_t quantum);
+
+  /**
+   * \brief Get the number of flow queues of this traffic class
+   * \return Number of flow queues, 0 for a single FIFO
+   */
+  uint32_t GetFlowQueues () const;
+
   /**
    * \brief Set the filters for this traffic class
    * \param filters Vector of filters
@@ -137,14 +394,62 @@ public:
   bool IsDefault () const;
 
 private:
-  std::queue<Ptr<Packet>> m_queue;     //!< Queue of packets
+  /**
+   * \brief Enqueue a packet into one flow queue
+   * \param pkt Packet to enqueue
+   * \param handle Position of the packet in the DiffServ base-class container
+   * \param flow Flow queue of the packet, ignored without flow queues
+   * \return true if the packet was successfully enqueued
+   */
+  bool Enqueue (Ptr<Packet> pkt, std::list<Ptr<Packet>>::const_iterator handle, uint32_t flow);
+
+  /**
+   * \brief Get the slot of the packet to dequeue next
+   * \return The slot; the queue must not be empty
+   */
+  const QueueSlot& GetHeadSlot () const;
+
+  /**
+   * \brief Get the flow queue of a packet
+   * \param key The parsed header fields of the packet
+   * \return Index of the flow queue
+   */
+  uint32_t GetFlow (const FlowKey& key) const;
+
+  /**
+   * \brief Get the child class the child scheduler would serve next
+   * \return The class; this node must not be empty
+   */
+  TrafficClass* GetScheduledChild () const;
+
+  /**
+   * \brief Report a change to the filters or default flag to the owner
+   */
+  void NotifyRulesetChanged ();
+
+  std::vector<QueueSlot> m_ring;       //!< Ring buffer of packet slots
   std::vector<Filter*> m_filters;      //!< Filters for this traffic class
+  SojournHistogram m_sojourn;          //!< Sojourn times of dequeued packets
 
+  uint32_t m_head;                     //!< Ring index of the oldest packet
   uint32_t m_packets;                  //!< Current number of packets in the queue
   uint32_t m_maxPackets;               //!< Maximum number of packets allowed
+  uint32_t m_bytes;                    //!< Current number of bytes in the queue
+  uint32_t m_maxBytes;                 //!< Maximum number of bytes allowed (0 = no limit)
   double m_weight;                     //!< Weight for DRR scheduling
   uint32_t m_priority;                 //!< Priority for SPQ scheduling
   bool m_isDefault;                    //!< Whether this is the default traffic class
+  DataRate m_rate;                     //!< Rate of the token bucket (0 = unshaped)
+  uint32_t m_burst;                    //!< Size of the token bucket in bytes
+  double m_tokens;                     //!< Tokens in bytes, negative while in debt
+  Time m_tokenTime;                    //!< Time of the last token update
+  Aqm* m_aqm;                          //!< Active queue management, nullptr for tail drop only
+  FlowQueues m_flowQueues;             //!< Flow queues over the ring slots, if any
+  uint32_t m_pendingFlow;              //!< Flow queue found by the last CanStore
+  bool m_pendingEvict;                 //!< Whether the last CanStore planned an eviction
+  uint32_t m_pendingEvictSize;         //!< Size of the packet to evict
+  Ptr<DiffServ> m_child;               //!< Child scheduler of a node, nullptr for a leaf
+  DiffServ* m_owner;                   //!< Scheduler holding this class, nullptr until added
 };
 
 } // namespace ns3
@@ -5,6 +5,7 @@
 
 #include <fstream>
 #include <iostream>
+#include "filter-element-dscp.h"
 #include "filter-element-dst-port.h"
 #include "validation.h"
 
@@ -17,6 +18,8 @@ namespace ns3
 Validation::Validation ()
   : spq (nullptr),
     drr (nullptr),
+    wf2q (nullptr),
+    pifo (nullptr),
     m_clientNode (nullptr),
     m_routerNode (nullptr),
     m_serverNode (nullptr)
@@ -71,30 +74,10 @@ Validation::ParseConfigs (const std::string& filename)
       for (const auto& q : cfg["queues"])
         {
           QueueConfig queueConfig;
-
-          // Common fields
-          queueConfig.no = q.value ("no", 0);
-          queueConfig.isDefault = q.value ("Default", false);
-          queueConfig.maxPackets = q.value ("MaxPackets", 0u);
-          queueConfig.destPort = q.value ("DestPort", 0u);
-          queueConfig.srcPort = q.value ("SrcPort", 0u);
-          queueConfig.protocol = q.value ("protocol", "");
-          queueConfig.mask = q.value ("mask", "");
-          queueConfig.destIp = q.value ("DestIp", "");
-          queueConfig.sourceIp = q.value ("SourceIp", "");
-
-          // Specific fields based on scheduler type
-          if (m_configData.name == "spq")
-            {
-              queueConfig.priority = q.value ("Priority", 0u);
-              queueConfig.weight = 0; // Not used in SPQ
-            }
-          else if (m_configData.name == "drr")
+          if (!ParseQueue (q, m_configData.name, queueConfig))
             {
-              queueConfig.weight = q.value ("Weight", 0u);
-              queueConfig.priority = 0; // Not used in DRR
+              return false;
             }
-
           m_configData.queues.push_back (queueConfig);
         }
     }
@@ -110,6 +93,16 @@ Validation::ParseConfigs (const std::string& filename)
       // Initialize DRR configuration
       drr = CreateObject<DRR> ();
     }
+  else if (m_configData.name == "wf2q")
+    {
+      // Initialize WF2Q+ configuration
+      wf2q = CreateObject<WF2Q> ();
+    }
+  else if (m_configData.name == "pifo")
+    {
+      // Initialize PIFO configuration
+      pifo = CreateObject<PIFO> ();
+    }
   else
     {
       std::cerr << "Unknown scheduler type: " << m_configData.name << std::endl;
@@ -121,6 +114,112 @@ Validation::ParseConfigs (const std::string& filename)
 
 
 
+/**
+ * \brief Parse one queue configuration and, recursively, its child queues
+ * \param q JSON object of the queue
+ * \param name Name of the scheduler the queue belongs to
+ * \param queueConfig Set to the queue configuration
+ * \return true if the queue and its children are valid, false otherwise
+ */
+bool
+Validation::ParseQueue (const nlohmann::json& q, const std::string& name, QueueConfig& queueConfig) const
+{
+  // Common fields
+  queueConfig.no = q.value ("no", 0);
+  queueConfig.isDefault = q.value ("Default", false);
+  queueConfig.maxPackets = q.value ("MaxPackets", 0u);
+  queueConfig.maxBytes = q.value ("MaxBytes", 0u);
+  queueConfig.destPort = q.value ("DestPort", 0u);
+  queueConfig.srcPort = q.value ("SrcPort", 0u);
+  queueConfig.protocol = q.value ("protocol", "");
+  queueConfig.mask = q.value ("mask", "");
+  queueConfig.destIp = q.value ("DestIp", "");
+  queueConfig.sourceIp = q.value ("SourceIp", "");
+  queueConfig.rate = q.value ("Rate", "");
+  queueConfig.burst = q.value ("Burst", 0u);
+  queueConfig.aqm = q.value ("Aqm", "");
+  queueConfig.target = q.value ("Target", 0.0);
+  queueConfig.interval = q.value ("Interval", 0.0);
+  queueConfig.flowQueues = q.value ("FlowQueues", 0u);
+  queueConfig.flowQuantum = q.value ("FlowQuantum", 1500u);
+
+  // DSCP code points, as a single value or a list
+  if (q.contains ("Dscp"))
+    {
+      const auto& dscp = q["Dscp"];
+      std::vector<int64_t> codePoints;
+      if (dscp.is_array ())
+        {
+          for (const auto& codePoint : dscp)
+            {
+              codePoints.push_back (codePoint.get<int64_t> ());
+            }
+        }
+      else
+        {
+          codePoints.push_back (dscp.get<int64_t> ());
+        }
+
+      // A code point is six bits; a larger value would alias a smaller one
+      for (int64_t codePoint : codePoints)
+        {
+          if (codePoint < 0 || codePoint > 63)
+            {
+              std::cerr << "Invalid DSCP " << codePoint << " in queue " << queueConfig.no
+                        << ": code points range from 0 to 63" << std::endl;
+              return false;
+            }
+          queueConfig.dscp.push_back (static_cast<uint8_t> (codePoint));
+        }
+    }
+
+  // Specific fields based on scheduler type
+  queueConfig.priority = 0;
+  queueConfig.weight = 0;
+  queueConfig.deadline = 0;
+  if (name == "spq")
+    {
+      queueConfig.priority = q.value ("Priority", 0u);
+    }
+  else if (name == "drr" || name == "wf2q")
+    {
+      queueConfig.weight = q.value ("Weight", 0u);
+    }
+  else if (name == "pifo")
+    {
+      // The rank function decides which of these is used
+      queueConfig.priority = q.value ("Priority", 0u);
+      queueConfig.weight = q.value ("Weight", 0u);
+      queueConfig.rank = q.value ("Rank", "priority");
+      queueConfig.deadline = q.value ("Deadline", 0.0);
+    }
+
+  // A queue with its own queues is a scheduler node, by default a DRR
+  if (q.contains ("queues") && q["queues"].is_array ())
+    {
+      queueConfig.scheduler = q.value ("scheduler", "drr");
+      uint32_t childPackets = 0;
+      for (const auto& child : q["queues"])
+        {
+          QueueConfig childConfig;
+          if (!ParseQueue (child, queueConfig.scheduler, childConfig))
+            {
+              return false;
+            }
+          queueConfig.queues.push_back (childConfig);
+          childPackets += childConfig.maxPackets;
+        }
+
+      // Without its own limit, a node holds what its children hold
+      if (queueConfig.maxPackets == 0)
+        {
+          queueConfig.maxPackets = childPackets;
+        }
+    }
+
+  return true;
+}
+
 /**
  * \brief Initialize the appropriate QoS mechanism based on configuration
  */
@@ -135,6 +234,14 @@ Validation::InitializeQoSMechanism ()
     {
       InitializeDRR ();
     }
+  else if (m_configData.name == "wf2q")
+    {
+      InitializeWF2Q ();
+    }
+  else if (m_configData.name == "pifo")
+    {
+      InitializePIFO ();
+    }
   else
     {
       std::cerr << "Cannot initialize unknown QoS mechanism: " << m_configData.name << std::endl;
@@ -154,20 +261,7 @@ Validation::InitializeSPQ ()
     }
 
   // Create traffic classes for all queues in the configuration
-  for (size_t i = 0; i < m_configData.queues.size (); i++)
-    {
-      TrafficClass* tc = new TrafficClass ();
-      tc->SetMaxPackets (m_configData.queues[i].maxPackets);
-      tc->SetPriority (m_configData.queues[i].priority);
-      tc->SetIsDefault (m_configData.queues[i].isDefault);
-
-      // Create a filter for this traffic class based on destination port
-      Filter* filter = new Filter ();
-      FilterElementDstPort* portFilter = new FilterElementDstPort (m_configData.queues[i].destPort);
-      filter->AddFilterElement (portFilter);
-      tc->AddFilter (filter);
-      spq->AddClass (tc);
-    }
+  AddClasses (spq, m_configData.queues);
 }
 
 /**
@@ -183,20 +277,267 @@ Validation::InitializeDRR ()
     }
 
   // Configure DRR using the stored configuration data
-  for (const auto& queueConfig : m_configData.queues)
+  AddClasses (drr, m_configData.queues);
+}
+
+/**
+ * \brief Initialize WF2Q+ scheduler with traffic classes from configuration
+ */
+void
+Validation::InitializeWF2Q ()
+{
+  // Create WF2Q+ scheduler if not already created
+  if (!wf2q)
     {
-      TrafficClass* tc = new TrafficClass ();
+      wf2q = CreateObject<WF2Q> ();
+    }
+
+  // Classes take their share from the same Weight field as DRR
+  AddClasses (wf2q, m_configData.queues);
+}
+
+/**
+ * \brief Initialize PIFO scheduler with traffic classes from configuration
+ */
+void
+Validation::InitializePIFO ()
+{
+  // Create PIFO scheduler if not already created
+  if (!pifo)
+    {
+      pifo = CreateObject<PIFO> ();
+    }
+
+  AddClasses (pifo, m_configData.queues);
+}
+
+/**
+ * \brief Create a scheduler by name
+ * \param name Name of the scheduler ("spq", "drr", "wf2q" or "pifo")
+ * \return The scheduler, or nullptr if the name is unknown
+ */
+Ptr<DiffServ>
+Validation::CreateScheduler (const std::string& name)
+{
+  if (name == "spq")
+    {
+      return CreateObject<SPQ> ();
+    }
+  if (name == "drr")
+    {
+      return CreateObject<DRR> ();
+    }
+  if (name == "wf2q")
+    {
+      return CreateObject<WF2Q> ();
+    }
+  if (name == "pifo")
+    {
+      return CreateObject<PIFO> ();
+    }
+  return nullptr;
+}
+
+/**
+ * \brief Create the active queue management of a queue configuration
+ * \param queueConfig The queue configuration
+ * \return The AQM, or nullptr if none or an unknown one is configured
+ */
+Aqm*
+Validation::CreateAqm (const QueueConfig& queueConfig)
+{
+  // Unset times keep the defaults of the algorithm
+  if (queueConfig.aqm == "codel")
+    {
+      return new CoDel (queueConfig.target > 0 ? Seconds (queueConfig.target / 1000.0) : MilliSeconds (5),
+                        queueConfig.interval > 0 ? Seconds (queueConfig.interval / 1000.0) : MilliSeconds (100));
+    }
+  if (queueConfig.aqm == "pie")
+    {
+      return new PIE (queueConfig.target > 0 ? Seconds (queueConfig.target / 1000.0) : MilliSeconds (15),
+                      queueConfig.interval > 0 ? Seconds (queueConfig.interval / 1000.0) : MilliSeconds (15));
+    }
+  if (!queueConfig.aqm.empty ())
+    {
+      std::cerr << "Unknown AQM: " << queueConfig.aqm << std::endl;
+    }
+  return nullptr;
+}
+
+/**
+ * \brief Add a traffic class per queue configuration to a scheduler,
+ *        with a child scheduler for every queue that has child queues
+ * \param scheduler The scheduler to fill
+ * \param queues The queue configurations
+ */
+void
+Validation::AddClasses (Ptr<DiffServ> scheduler, const std::vector<QueueConfig>& queues)
+{
+  for (const auto& queueConfig : queues)
+    {
+      TrafficClass* tc = scheduler->GetArena ().Create<TrafficClass> ();
+
+      // A node gets its child scheduler first, as it then needs no ring
+      if (!queueConfig.queues.empty ())
+        {
+          Ptr<DiffServ> child = CreateScheduler (queueConfig.scheduler);
+          if (child == nullptr)
+            {
+              std::cerr << "Unknown scheduler type: " << queueConfig.scheduler << std::endl;
+            }
+          else
+            {
+              AddClasses (child, queueConfig.queues);
+              tc->SetChild (child);
+            }
+        }
+
       tc->SetMaxPackets (queueConfig.maxPackets);
+      tc->SetMaxBytes (queueConfig.maxBytes);
+      tc->SetPriority (queueConfig.priority);
       tc->SetWeight (queueConfig.weight);
+      tc->SetIsDefault (queueConfig.isDefault);
+      if (!queueConfig.rate.empty ())
+        {
+          tc->SetRate (DataRate (queueConfig.rate));
+          tc->SetBurst (queueConfig.burst);
+        }
+      if (queueConfig.queues.empty ())
+        {
+          tc->SetAqm (CreateAqm (queueConfig));
+          tc->SetFlowQueues (queueConfig.flowQueues, queueConfig.flowQuantum);
+        }
+
+      AddQueueFilters (scheduler->GetArena (), tc, queueConfig);
+      scheduler->AddClass (tc);
 
-      Filter* filter = new Filter ();
-      FilterElementDstPort* portFilter = new FilterElementDstPort (queueConfig.destPort);
-      filter->AddFilterElement (portFilter);
-      tc->AddFilter (filter);
-      drr->AddClass (tc);
+      // Rank the class as configured, by priority if the name is unknown
+      Ptr<PIFO> pifoScheduler = DynamicCast<PIFO> (scheduler);
+      if (pifoScheduler != nullptr)
+        {
+          uint32_t index = pifoScheduler->GetClasses ().size () - 1;
+          RankPolicy policy = RANK_PRIORITY;
+          if (!PIFO::ParseRankPolicy (queueConfig.rank, policy))
+            {
+              std::cerr << "Unknown rank function: " << queueConfig.rank << std::endl;
+            }
+          pifoScheduler->SetRankPolicy (index, policy);
+          pifoScheduler->SetDeadline (index, Seconds (queueConfig.deadline / 1000.0));
+        }
     }
 }
 
+/**
+ * \brief Collect the leaf queues below a list of queue configurations
+ * \param queues The queue configurations
+ * \param leaves Receives the leaf queues, in configuration order
+ */
+void
+Validation::CollectLeaves (const std::vector<QueueConfig>& queues,
+                           std::vector<const QueueConfig*>& leaves)
+{
+  for (const auto& queueConfig : queues)
+    {
+      if (queueConfig.queues.empty ())
+        {
+          leaves.push_back (&queueConfig);
+        }
+      else
+        {
+          CollectLeaves (queueConfig.queues, leaves);
+        }
+    }
+}
+
+/**
+ * \brief Add the filters of a queue configuration to its traffic class
+ * \param arena Arena of the scheduler of the class, which owns the filters
+ * \param tc The traffic class of the queue
+ * \param queueConfig The queue configuration
+ */
+void
+Validation::AddQueueFilters (Arena& arena, TrafficClass* tc, const QueueConfig& queueConfig)
+{
+  // A node without its own criteria takes every packet of its child queues
+  if (!queueConfig.queues.empty () && queueConfig.dscp.empty () && queueConfig.destPort == 0)
+    {
+      for (const auto& child : queueConfig.queues)
+        {
+          AddQueueFilters (arena, tc, child);
+        }
+      return;
+    }
+
+  // Classify by DSCP if code points are configured: one filter per code point
+  if (!queueConfig.dscp.empty ())
+    {
+      for (uint8_t dscp : queueConfig.dscp)
+        {
+          Filter* filter = arena.Create<Filter> ();
+          filter->AddFilterElement (arena.Create<FilterElementDscp> (dscp));
+          tc->AddFilter (filter);
+        }
+      return;
+    }
+
+  // Otherwise create a filter for this traffic class based on destination port
+  Filter* filter = arena.Create<Filter> ();
+  FilterElementDstPort* portFilter = arena.Create<FilterElementDstPort> (queueConfig.destPort);
+  filter->AddFilterElement (portFilter);
+  tc->AddFilter (filter);
+}
+
+/**
+ * \brief Create the helper of the UDP client of a queue
+ * \param queueConfig The queue configuration
+ * \return Helper sending to the server port of the queue, with the TOS
+ *         of its first code point
+ */
+UdpClientHelper
+Validation::CreateClientHelper (const QueueConfig& queueConfig) const
+{
+  UdpClientHelper client (InetSocketAddress (m_interfaces2.GetAddress (1), queueConfig.destPort));
+  if (!queueConfig.dscp.empty ())
+    {
+      // The DSCP is the upper six bits of the TOS byte
+      client.SetAttribute ("Tos", UintegerValue (queueConfig.dscp[0] << 2));
+    }
+  return client;
+}
+
+/**
+ * \brief Attach a scheduler to the point-to-point device it shapes
+ * \param queue The root scheduler
+ * \param device The device sending the packets of the scheduler
+ *
+ * The device only dequeues when it enqueues a packet or ends a
+ * transmission, so the scheduler is also given a way to hand it the
+ * packets its shaper releases while the device is idle.
+ */
+void
+Validation::AttachQueue (Ptr<DiffServ> queue, Ptr<PointToPointNetDevice> device)
+{
+  queue->SetLinkType (LINK_PPP);
+  queue->SetTransmitCallback (MakeBoundCallback (&Validation::SendReleased, device));
+  device->SetQueue (queue);
+}
+
+/**
+ * \brief Hand a packet released by the shaper back to an idle device
+ * \param device The device the scheduler is attached to
+ * \param packet The packet, with its PPP header
+ * \return true if the device accepted the packet
+ */
+bool
+Validation::SendReleased (Ptr<PointToPointNetDevice> device, Ptr<Packet> packet)
+{
+  // Send adds the PPP header again, from the EtherType of the protocol
+  PppHeader ppp;
+  packet->RemoveHeader (ppp);
+  uint16_t protocol = ppp.GetProtocol () == 0x0057 ? 0x86dd : 0x0800; // IPv6 or IPv4
+  return device->Send (packet, device->GetBroadcast (), protocol);
+}
+
 /**
  * \brief Set up the network topology (client-router-server)
  */
@@ -254,59 +595,51 @@ Validation::InitializeUdpApplication ()
   
   if (m_configData.name == "spq")
     {
-      clientRouter->SetQueue (spq);
+      AttachQueue (spq, clientRouter);
 
-      UdpServerHelper server1 (m_configData.queues[0].destPort);
-      UdpServerHelper server2 (m_configData.queues[1].destPort);
-
-      // Install servers with synchronized timing
-      auto apps1 = server1.Install (m_serverNode);
-      apps1.Start (Seconds (0.0));
-      apps1.Stop (Seconds(40.0));
-
-      auto apps2 = server2.Install (m_serverNode);
-      apps2.Start (Seconds (0.0));
-      apps2.Stop (Seconds(40.0));
-
-      UdpClientHelper client1 (m_interfaces2.GetAddress (1), m_configData.queues[0].destPort);
-      client1.SetAttribute ("MaxPackets", UintegerValue (m_configData.queues[0].maxPackets));
-      client1.SetAttribute ("Interval", TimeValue (interPacketInterval));
-      client1.SetAttribute ("PacketSize", UintegerValue (maxPacketSize));
-
-      UdpClientHelper client2 (m_interfaces2.GetAddress (1), m_configData.queues[1].destPort);
-      client2.SetAttribute ("MaxPackets", UintegerValue (m_configData.queues[1].maxPackets));
-      client2.SetAttribute ("Interval", TimeValue (interPacketInterval));
-      client2.SetAttribute ("PacketSize", UintegerValue (maxPacketSize));
-
-      // Install clients with synchronized timing
-      // Start client1 (port 10000) at 15s and stop at 30s
-      apps1 = client1.Install (m_clientNode);
-      apps1.Start (Seconds (15.0));
-      apps1.Stop (Seconds (30.0));
+      // The first leaf queue, the high priority one of spq_config.json,
+      // sends from 15s to 30s and the others from 0s to 40s
+      std::vector<const QueueConfig*> leaves;
+      CollectLeaves (m_configData.queues, leaves);
+      for (uint32_t i = 0; i < leaves.size (); i++)
+        {
+          UdpServerHelper server (leaves[i]->destPort);
+          auto app = server.Install (m_serverNode);
+          app.Start (Seconds (0.0));
+          app.Stop (Seconds (40.0));
 
-      // Start client2 (port 10001) at 0s and stop at 40s
-      apps2 = client2.Install (m_clientNode);
-      apps2.Start (Seconds (0.0));
-      apps2.Stop (Seconds(40.0));
+          UdpClientHelper client = CreateClientHelper (*leaves[i]);
+          client.SetAttribute ("MaxPackets", UintegerValue (leaves[i]->maxPackets));
+          client.SetAttribute ("Interval", TimeValue (interPacketInterval));
+          client.SetAttribute ("PacketSize", UintegerValue (maxPacketSize));
+          auto cApp = client.Install (m_clientNode);
+          cApp.Start (Seconds (i == 0 ? 15.0 : 0.0));
+          cApp.Stop (Seconds (i == 0 ? 30.0 : 40.0));
+        }
 
       // Enable packet capture for analysis
       m_p1Help.EnablePcap ("scratch/final-project/Pre_SPQ", m_devices1.Get (1));
       m_p2Help.EnablePcap ("scratch/final-project/Post_SPQ", m_devices2.Get (0));
     }
-  else if (m_configData.name == "drr")
+  else if (m_configData.name == "drr" || m_configData.name == "wf2q" || m_configData.name == "pifo")
     {
-      clientRouter->SetQueue (drr);
-
-      // DRR: all clients start together at time 0
-      for (int i = 0; i < 3; i++)
+      // DRR, WF2Q+ and PIFO share the setup with concurrent clients
+      Ptr<DiffServ> queue = drr ? Ptr<DiffServ> (drr) : wf2q ? Ptr<DiffServ> (wf2q) : Ptr<DiffServ> (pifo);
+      std::string trace = drr ? "DRR" : wf2q ? "WF2Q" : "PIFO";
+      AttachQueue (queue, clientRouter);
+
+      // All clients start together at time 0, one per leaf queue
+      std::vector<const QueueConfig*> leaves;
+      CollectLeaves (m_configData.queues, leaves);
+      for (const QueueConfig* leaf : leaves)
         {
-          UdpServerHelper server (m_configData.queues[i].destPort);
+          UdpServerHelper server (leaf->destPort);
           auto app = server.Install (m_serverNode);
           app.Start (Seconds (0.0));
           app.Stop (Seconds (40.0));
 
-          UdpClientHelper client (m_interfaces2.GetAddress (1), m_configData.queues[i].destPort);
-          client.SetAttribute ("MaxPackets", UintegerValue (m_configData.queues[i].maxPackets));
+          UdpClientHelper client = CreateClientHelper (*leaf);
+          client.SetAttribute ("MaxPackets", UintegerValue (leaf->maxPackets));
           client.SetAttribute ("Interval", TimeValue (interPacketInterval));
           client.SetAttribute ("PacketSize", UintegerValue (maxPacketSize));
           auto cApp = client.Install (m_clientNode);
@@ -315,8 +648,8 @@ Validation::InitializeUdpApplication ()
         }
 
       // Enable packet capture for analysis
-      m_p1Help.EnablePcap ("scratch/final-project/Pre_DRR", m_devices1.Get (1));
-      m_p2Help.EnablePcap ("scratch/final-project/Post_DRR", m_devices2.Get (0));
+      m_p1Help.EnablePcap ("scratch/final-project/Pre_" + trace, m_devices1.Get (1));
+      m_p2Help.EnablePcap ("scratch/final-project/Post_" + trace, m_devices2.Get (0));
     }
   else
     {
@@ -325,4 +658,42 @@ Validation::InitializeUdpApplication ()
 
 }
 
-} 
\ No newline at end of file
+/**
+ * \brief Print the statistics of the scheduler: per-class sojourn-time
+ *        percentiles and flow cache counters
+ * \param os Output stream
+ */
+void
+Validation::PrintStatistics (std::ostream& os) const
+{
+  if (spq)
+    {
+      os << "SPQ sojourn times" << std::endl;
+      spq->PrintSojournTimes (os);
+      os << "SPQ flow cache hits " << spq->GetFlowCacheHits ()
+         << " misses " << spq->GetFlowCacheMisses () << std::endl;
+    }
+  if (drr)
+    {
+      os << "DRR sojourn times" << std::endl;
+      drr->PrintSojournTimes (os);
+      os << "DRR flow cache hits " << drr->GetFlowCacheHits ()
+         << " misses " << drr->GetFlowCacheMisses () << std::endl;
+    }
+  if (wf2q)
+    {
+      os << "WF2Q+ sojourn times" << std::endl;
+      wf2q->PrintSojournTimes (os);
+      os << "WF2Q+ flow cache hits " << wf2q->GetFlowCacheHits ()
+         << " misses " << wf2q->GetFlowCacheMisses () << std::endl;
+    }
+  if (pifo)
+    {
+      os << "PIFO sojourn times" << std::endl;
+      pifo->PrintSojournTimes (os);
+      os << "PIFO flow cache hits " << pifo->GetFlowCacheHits ()
+         << " misses " << pifo->GetFlowCacheMisses () << std::endl;
+    }
+}
+
+}
@@ -14,6 +14,10 @@
 #include <nlohmann/json.hpp>
 #include "spq.h"
 #include "drr.h"
+#include "wf2q.h"
+#include "pifo.h"
+#include "codel.h"
+#include "pie.h"
 #include <vector>
 
 namespace ns3 {
@@ -29,18 +33,35 @@ struct QueueConfig
   int no;                  //!< Queue number/identifier
   bool isDefault;          //!< Whether this is the default queue
   uint32_t maxPackets;     //!< Maximum number of packets in queue
+  uint32_t maxBytes;       //!< Maximum number of bytes in queue (0 = no limit)
   uint16_t destPort;       //!< Destination port for filtering
   uint16_t srcPort;        //!< Source port for filtering
   std::string protocol;    //!< Protocol for filtering
   std::string mask;        //!< Network mask for filtering
   std::string destIp;      //!< Destination IP for filtering
   std::string sourceIp;    //!< Source IP for filtering
+  std::vector<uint8_t> dscp; //!< DSCP code points classified into the queue (empty = by port)
+  std::string rate;        //!< Committed rate of the token bucket, e.g. "1Mbps" (empty = unshaped)
+  uint32_t burst;          //!< Size of the token bucket in bytes
+  std::string aqm;         //!< Active queue management ("codel" or "pie", empty = tail drop only)
+  double target;           //!< AQM target delay in milliseconds (0 = AQM default)
+  double interval;         //!< CoDel interval or PIE update period in milliseconds (0 = AQM default)
+  uint32_t flowQueues;     //!< Number of flow queues inside the queue (0 = single FIFO)
+  uint32_t flowQuantum;    //!< Bytes each flow queue may send per round
   
   // SPQ specific
   uint32_t priority;       //!< Priority level (lower value = higher priority)
   
   // DRR specific
   uint32_t weight;         //!< Weight for DRR scheduling
+
+  // PIFO specific
+  std::string rank;        //!< Rank function ("priority", "finish", "deadline" or "las")
+  double deadline;         //!< Delay budget in milliseconds for the "deadline" rank
+
+  // Scheduler nodes
+  std::string scheduler;           //!< Scheduler of the child queues ("spq", "drr", "wf2q" or "pifo")
+  std::vector<QueueConfig> queues; //!< Child queues (empty = leaf queue)
 };
 
 /**
@@ -48,7 +69,7 @@ struct QueueConfig
  */
 struct ConfigData
 {
-  std::string name;                //!< QoS mechanism name ("spq" or "drr")
+  std::string name;                //!< QoS mechanism name ("spq", "drr", "wf2q" or "pifo")
   std::vector<QueueConfig> queues; //!< List of queue configurations
 };
 
@@ -88,6 +109,16 @@ public:
    */
   void InitializeDRR ();
 
+  /**
+   * \brief Initialize WF2Q+ scheduler with traffic classes from configuration
+   */
+  void InitializeWF2Q ();
+
+  /**
+   * \brief Initialize PIFO scheduler with traffic classes from configuration
+   */
+  void InitializePIFO ();
+
   /**
    * \brief Set up the network topology (client-router-server)
    */
@@ -98,15 +129,22 @@ public:
    */
   void InitializeUdpApplication ();
 
+  /**
+   * \brief Print the statistics of the scheduler: per-class sojourn-time
+   *        percentiles and flow cache counters
+   * \param os Output stream
+   */
+  void PrintStatistics (std::ostream& os) const;
+
   /**
    * \brief Get the name of the configured QoS mechanism
-   * \return Name of the QoS mechanism ("spq" or "drr")
+   * \return Name of the QoS mechanism ("spq", "drr", "wf2q" or "pifo")
    */
   std::string GetName () const { return m_configData.name; }
   
   /**
    * \brief Set the name of the QoS mechanism
-   * \param name Name to set ("spq" or "drr")
+   * \param name Name to set ("spq", "drr", "wf2q" or "pifo")
    */
   void SetName (std::string& name) { m_configData.name = name; }
 
@@ -119,8 +157,80 @@ public:
   // Queue scheduler instances
   Ptr<SPQ> spq; //!< SPQ scheduler instance
   Ptr<DRR> drr; //!< DRR scheduler instance
+  Ptr<WF2Q> wf2q; //!< WF2Q+ scheduler instance
+  Ptr<PIFO> pifo; //!< PIFO scheduler instance
 
 private:
+  /**
+   * \brief Parse one queue configuration and, recursively, its child queues
+   * \param q JSON object of the queue
+   * \param name Name of the scheduler the queue belongs to
+   * \param queueConfig Set to the queue configuration
+   * \return true if the queue and its children are valid, false otherwise
+   */
+  bool ParseQueue (const nlohmann::json& q, const std::string& name, QueueConfig& queueConfig) const;
+
+  /**
+   * \brief Create a scheduler by name
+   * \param name Name of the scheduler ("spq", "drr", "wf2q" or "pifo")
+   * \return The scheduler, or nullptr if the name is unknown
+   */
+  static Ptr<DiffServ> CreateScheduler (const std::string& name);
+
+  /**
+   * \brief Create the active queue management of a queue configuration
+   * \param queueConfig The queue configuration
+   * \return The AQM, or nullptr if none or an unknown one is configured
+   */
+  static Aqm* CreateAqm (const QueueConfig& queueConfig);
+
+  /**
+   * \brief Add a traffic class per queue configuration to a scheduler,
+   *        with a child scheduler for every queue that has child queues
+   * \param scheduler The scheduler to fill
+   * \param queues The queue configurations
+   */
+  void AddClasses (Ptr<DiffServ> scheduler, const std::vector<QueueConfig>& queues);
+
+  /**
+   * \brief Collect the leaf queues below a list of queue configurations
+   * \param queues The queue configurations
+   * \param leaves Receives the leaf queues, in configuration order
+   */
+  static void CollectLeaves (const std::vector<QueueConfig>& queues,
+                             std::vector<const QueueConfig*>& leaves);
+
+  /**
+   * \brief Add the filters of a queue configuration to its traffic class
+   * \param arena Arena of the scheduler of the class, which owns the filters
+   * \param tc The traffic class of the queue
+   * \param queueConfig The queue configuration
+   */
+  void AddQueueFilters (Arena& arena, TrafficClass* tc, const QueueConfig& queueConfig);
+
+  /**
+   * \brief Create the helper of the UDP client of a queue
+   * \param queueConfig The queue configuration
+   * \return Helper sending to the server port of the queue, with the TOS
+   *         of its first code point
+   */
+  UdpClientHelper CreateClientHelper (const QueueConfig& queueConfig) const;
+
+  /**
+   * \brief Attach a scheduler to the point-to-point device it shapes
+   * \param queue The root scheduler
+   * \param device The device sending the packets of the scheduler
+   */
+  static void AttachQueue (Ptr<DiffServ> queue, Ptr<PointToPointNetDevice> device);
+
+  /**
+   * \brief Hand a packet released by the shaper back to an idle device
+   * \param device The device the scheduler is attached to
+   * \param packet The packet, with its PPP header
+   * \return true if the device accepted the packet
+   */
+  static bool SendReleased (Ptr<PointToPointNetDevice> device, Ptr<Packet> packet);
+
   // Parsed configuration data
   ConfigData m_configData; //!< Parsed configuration data
   
@@ -0,0 +1,167 @@
+/*
+ * This program implements a Worst-case Fair Weighted Fair Queuing (WF2Q+)
+ * scheduler for Quality of Service (QoS) packet scheduling.
+ */
+
+#include "wf2q.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+/**
+ * \brief Constructor - starts with no classes and a virtual time of zero
+ */
+WF2Q::WF2Q ()
+  : m_virtualTime (0)
+{
+}
+
+/**
+ * \brief Recompute the virtual time cost per byte of every class
+ *
+ * A class with share w / sum(w) needs sum(w) / w units of virtual time
+ * per byte, while the system virtual time advances by one unit per byte
+ * sent. Classes without a positive weight get the lowest positive weight,
+ * as in DRR.
+ */
+void
+WF2Q::UpdateShares ()
+{
+  const std::vector<TrafficClass*>& queueList = GetClasses ();
+
+  double minWeight = 0;
+  for (auto tc : queueList)
+    {
+      if (tc->GetWeight () > 0 && (minWeight == 0 || tc->GetWeight () < minWeight))
+        {
+          minWeight = tc->GetWeight ();
+        }
+    }
+  if (minWeight == 0)
+    {
+      minWeight = 1;
+    }
+
+  double totalWeight = 0;
+  for (auto tc : queueList)
+    {
+      totalWeight += tc->GetWeight () > 0 ? tc->GetWeight () : minWeight;
+    }
+
+  for (uint32_t i = 0; i < queueList.size (); i++)
+    {
+      double weight = queueList[i]->GetWeight () > 0 ? queueList[i]->GetWeight () : minWeight;
+      m_costPerByte[i] = static_cast<uint64_t> (std::llround (std::ldexp (totalWeight / weight, SCALE_BITS)));
+    }
+}
+
+/**
+ * \brief Select the backlogged class with the earliest eligible finish time
+ * \return The scheduled class and the packet at its front
+ *
+ * Classes whose start time has been reached move to the eligible heap.
+ * If none is eligible, the virtual time jumps to the earliest start time
+ * (the max(V, min S) rule of WF2Q+). The moves only depend on the virtual
+ * time, so calling Schedule again before the dequeue selects the same
+ * class.
+ */
+ScheduleResult
+WF2Q::Schedule () const
+{
+  if (m_eligible.IsEmpty ())
+    {
+      if (m_waiting.IsEmpty ())
+        {
+          return {-1, nullptr};
+        }
+      m_virtualTime = std::max (m_virtualTime, m_waiting.TopKey ());
+    }
+
+  while (!m_waiting.IsEmpty () && m_waiting.TopKey () <= m_virtualTime)
+    {
+      uint32_t index = m_waiting.Pop ();
+      m_eligible.Push (index, m_finish[index]);
+    }
+
+  uint32_t index = m_eligible.Top ();
+  return {static_cast<int> (index), GetClasses ()[index]->Peek ()};
+}
+
+/**
+ * \brief Stamp a class with start and finish times when it becomes backlogged
+ * \param index Index of the traffic class the packet was enqueued into
+ *
+ * A class that was idle starts no earlier than the current virtual time,
+ * so it cannot claim service for the time it had nothing to send.
+ */
+void
+WF2Q::NotifyEnqueue (uint32_t index)
+{
+  if (m_eligible.Contains (index) || m_waiting.Contains (index))
+    {
+      return;
+    }
+
+  m_start[index] = std::max (m_finish[index], m_virtualTime);
+  m_finish[index] = m_start[index] + GetClasses ()[index]->GetHeadSize () * m_costPerByte[index];
+  m_waiting.Push (index, m_start[index]);
+}
+
+/**
+ * \brief Advance the virtual time and stamp the next packet of the class
+ * \param index Index of the traffic class the packet was dequeued from
+ * \param size Size of the dequeued packet in bytes
+ *
+ * The next packet of a still backlogged class starts where the previous
+ * one finished. An emptied or shaped-out class keeps its finish time for
+ * NotifyEnqueue. A packet dropped by the AQM (size 0) got no service, so
+ * its finish time is taken back and the next packet starts in its place.
+ */
+void
+WF2Q::NotifyDequeue (uint32_t index, uint32_t size)
+{
+  m_virtualTime += static_cast<uint64_t> (size) << SCALE_BITS;
+  if (size == 0)
+    {
+      m_finish[index] = m_start[index];
+    }
+
+  if (m_eligible.Contains (index))
+    {
+      m_eligible.Remove (index);
+    }
+  else if (m_waiting.Contains (index))
+    {
+      m_waiting.Remove (index);
+    }
+
+  if (IsReady (index))
+    {
+      m_start[index] = m_finish[index];
+      m_finish[index] = m_start[index] + GetClasses ()[index]->GetHeadSize () * m_costPerByte[index];
+      m_waiting.Push (index, m_start[index]);
+    }
+}
+
+/**
+ * \brief Add a new TrafficClass to the WF2Q+ queue system
+ * \param trafficClass Pointer to the TrafficClass instance
+ *
+ * This method adds a traffic class and recomputes the share of every
+ * class from the weights.
+ */
+void
+WF2Q::AddClass (TrafficClass* trafficClass)
+{
+  DiffServ::AddClass (trafficClass);
+  uint32_t n = GetClasses ().size ();
+  m_costPerByte.push_back (0);
+  m_start.push_back (0);
+  m_finish.push_back (0);
+  m_eligible.Resize (n);
+  m_waiting.Resize (n);
+  UpdateShares ();
+}
+
+} // namespace ns3
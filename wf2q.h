@@ -0,0 +1,88 @@
+/*
+ * This program implements a Worst-case Fair Weighted Fair Queuing (WF2Q+)
+ * scheduler for Quality of Service (QoS) packet scheduling.
+ */
+
+#ifndef WF2Q_H
+#define WF2Q_H
+
+#include "diff-serve.h"
+#include "indexed-heap.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup diffserv
+ * \brief WF2Q+ scheduler extending DiffServ
+ *
+ * This class implements the WF2Q+ algorithm of Bennett and Zhang. Every
+ * backlogged class has a virtual start and finish time for its head
+ * packet; the finish time advances by the packet size divided by the
+ * share of the class, where the share is its weight over the sum of all
+ * weights. Among the classes whose start time has been reached by the
+ * system virtual time, the one with the smallest finish time is served,
+ * so every class stays within one packet of its fluid fair share, unlike
+ * DRR's one quantum.
+ *
+ * Eligible classes are kept in an indexed min-heap by finish time and
+ * the others in one by start time, making enqueue and dequeue O(log N).
+ * Virtual times are 64-bit fixed point and the heaps are sized when
+ * classes are added, so the packet path never allocates.
+ */
+class WF2Q : public DiffServ
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  WF2Q ();
+
+  /**
+   * \brief Select the backlogged class with the earliest eligible finish time
+   * \return The scheduled class and the packet at its front
+   */
+  ScheduleResult Schedule () const override;
+
+  /**
+   * \brief Add a new TrafficClass to the WF2Q+ queue system
+   * \param trafficClass Pointer to the TrafficClass instance
+   *
+   * This method adds a traffic class and recomputes the share of every
+   * class from the weights.
+   */
+  void AddClass (TrafficClass* trafficClass) override;
+
+protected:
+  /**
+   * \brief Stamp a class with start and finish times when it becomes backlogged
+   * \param index Index of the traffic class the packet was enqueued into
+   */
+  void NotifyEnqueue (uint32_t index) override;
+
+  /**
+   * \brief Advance the virtual time and stamp the next packet of the class
+   * \param index Index of the traffic class the packet was dequeued from
+   * \param size Size of the dequeued packet in bytes
+   */
+  void NotifyDequeue (uint32_t index, uint32_t size) override;
+
+private:
+  /**
+   * \brief Recompute the virtual time cost per byte of every class
+   */
+  void UpdateShares ();
+
+  static constexpr uint32_t SCALE_BITS = 16; //!< Fractional bits of virtual times
+
+  std::vector<uint64_t> m_costPerByte;     //!< Virtual time per byte of each class
+  std::vector<uint64_t> m_start;           //!< Virtual start time of each head packet
+  std::vector<uint64_t> m_finish;          //!< Virtual finish time of each head packet
+  mutable uint64_t m_virtualTime;          //!< System virtual time
+  mutable IndexedHeap m_eligible;          //!< Eligible classes by finish time
+  mutable IndexedHeap m_waiting;           //!< Not yet eligible classes by start time
+};
+
+} // namespace ns3
+
+#endif // WF2Q_H